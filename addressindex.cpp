@@ -0,0 +1,54 @@
+#include "addressindex.h"
+#include <algorithm>
+#include <mutex>
+
+void AddressIndex::addBlock(const Block& block) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    const auto& transactions = block.getTransactions();
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        for (const auto& address : addressesOf(transactions[i])) {
+            // 区块按高度顺序接入，直接追加就保持了有序
+            entries_[address].push_back({transactions[i].getTransactionId(), block.getIndex(), i});
+        }
+    }
+}
+
+std::vector<AddressHistoryEntry> AddressIndex::getHistory(const std::string& address, int afterHeight,
+                                                          uint64_t afterPosition, size_t limit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<AddressHistoryEntry> result;
+    auto it = entries_.find(address);
+    if (it == entries_.end()) {
+        return result;
+    }
+
+    const auto& history = it->second;
+    auto begin = history.begin();
+    if (afterHeight >= 0) {
+        begin = std::upper_bound(history.begin(), history.end(), std::make_pair(afterHeight, afterPosition),
+            [](const std::pair<int, uint64_t>& key, const AddressHistoryEntry& entry) {
+                return key < std::make_pair(entry.height, entry.position);
+            });
+    }
+    for (auto entry = begin; entry != history.end() && result.size() < limit; ++entry) {
+        result.push_back(*entry);
+    }
+    return result;
+}
+
+size_t AddressIndex::getAddressCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::set<std::string> AddressIndex::addressesOf(const Transaction& tx) {
+    std::set<std::string> addresses;
+    addresses.insert(tx.getFrom());
+    addresses.insert(tx.getTo());
+    for (const auto& output : tx.getOutputs()) {
+        addresses.insert(output.getOwner());
+    }
+    addresses.erase("SYSTEM");
+    addresses.erase("");
+    return addresses;
+}
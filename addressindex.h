@@ -0,0 +1,39 @@
+#pragma once
+
+#include "block.h"
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+
+// 地址历史中的一条记录
+struct AddressHistoryEntry {
+    std::string txId;
+    int height;          // 所在区块高度，待处理交易为 -1
+    uint64_t position;   // 已确认交易为区块内下标，待处理交易为进入交易池的序号
+};
+
+// 一页地址历史；nextCursor 为空表示没有更多记录
+struct AddressHistoryPage {
+    std::vector<AddressHistoryEntry> entries;
+    std::string nextCursor;
+};
+
+// 已确认交易的地址索引：地址 -> 按 (高度, 下标) 排序的交易引用，区块接入时增量更新
+class AddressIndex {
+public:
+    void addBlock(const Block& block);
+    // 返回 (afterHeight, afterPosition) 之后最多 limit 条记录；afterHeight 为 -1 时从头开始
+    std::vector<AddressHistoryEntry> getHistory(const std::string& address, int afterHeight,
+                                                uint64_t afterPosition, size_t limit) const;
+    size_t getAddressCount() const;
+
+    // 一笔交易涉及的地址：发送方、接收方和所有输出的所有者（不含 SYSTEM）
+    static std::set<std::string> addressesOf(const Transaction& tx);
+
+private:
+    std::unordered_map<std::string, std::vector<AddressHistoryEntry>> entries_;
+    mutable std::shared_mutex mutex_;
+};
@@ -0,0 +1,34 @@
+#include "balancehistory.h"
+#include <algorithm>
+#include <mutex>
+
+void BalanceHistory::addBlock(const Block& block) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& [address, change] : block.getBalanceChanges()) {
+        auto& series = checkpoints_[address];
+        double previous = series.empty() ? 0.0 : series.back().balance;
+        series.push_back({block.getIndex(), previous + change});
+        checkpointCount_++;
+    }
+}
+
+double BalanceHistory::getBalanceAt(const std::string& address, int height) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = checkpoints_.find(address);
+    if (it == checkpoints_.end()) {
+        return 0.0;
+    }
+    const auto& series = it->second;
+    // 第一个高度大于 height 的检查点之前的那一个就是答案
+    auto next = std::upper_bound(series.begin(), series.end(), height,
+        [](int h, const Checkpoint& checkpoint) { return h < checkpoint.height; });
+    if (next == series.begin()) {
+        return 0.0;
+    }
+    return std::prev(next)->balance;
+}
+
+size_t BalanceHistory::getCheckpointCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return checkpointCount_;
+}
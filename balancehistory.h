@@ -0,0 +1,27 @@
+#pragma once
+
+#include "block.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+
+// 历史余额索引：地址 -> 按高度递增的 (高度, 该高度之后的累计余额) 检查点，
+// 只在余额发生变化的区块记录一个检查点，查询某一高度的余额时二分查找
+class BalanceHistory {
+public:
+    // 按高度顺序加入一个区块的余额变更（Block::getBalanceChanges）
+    void addBlock(const Block& block);
+    // address 在高度 height 的区块接入之后的余额；height 之前没有变化时为 0
+    double getBalanceAt(const std::string& address, int height) const;
+    size_t getCheckpointCount() const;
+
+private:
+    struct Checkpoint {
+        int height;
+        double balance;
+    };
+    std::unordered_map<std::string, std::vector<Checkpoint>> checkpoints_;
+    size_t checkpointCount_ = 0;
+    mutable std::shared_mutex mutex_;
+};
@@ -0,0 +1,125 @@
+// 区块压缩基准：构造一条由签名交易组成的链，统计区块压缩比和编解码吞吐量。
+// 分别测量单个区块（区块文件记录）和 BLOCKS 消息大小的分块（同步传输）。
+// 用法：compression_bench [区块数] [每块交易数] [解压轮数]
+#include "block.h"
+#include "compression.h"
+#include "transaction.h"
+#include "wallet.h"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+static const int WALLET_COUNT = 16;
+static const size_t BLOCKS_PER_CHUNK = 64;  // 与 P2PNode::BLOCKS_PER_CHUNK 一致
+
+struct Result {
+    size_t rawBytes = 0;
+    size_t packedBytes = 0;
+    double encodeSeconds = 0.0;
+    double decodeSeconds = 0.0;
+};
+
+static double mib(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+// 压缩每条记录一次，再整体解压 rounds 轮并校验结果
+static bool measure(const std::vector<std::string>& records, int rounds, Result& result) {
+    std::vector<std::string> packed;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& record : records) {
+        packed.push_back(Compression::compress(record));
+    }
+    result.encodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = 0; i < records.size(); ++i) {
+        result.rawBytes += records[i].size();
+        result.packedBytes += packed[i].size();
+    }
+
+    std::string raw;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < packed.size(); ++i) {
+            if (!Compression::decompress(packed[i], raw) || raw.size() != records[i].size()) {
+                return false;
+            }
+        }
+    }
+    result.decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return raw == records.back();
+}
+
+static void report(const std::string& name, size_t count, const Result& result, int rounds) {
+    std::cout << name << ": " << count << " records, " << result.rawBytes << " -> " << result.packedBytes
+              << " bytes, ratio " << static_cast<double>(result.rawBytes) / result.packedBytes
+              << ", encode " << mib(result.rawBytes) / result.encodeSeconds << " MiB/s"
+              << ", decode " << mib(result.rawBytes) * rounds / result.decodeSeconds << " MiB/s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int blockCount = argc > 1 ? std::stoi(argv[1]) : 200;
+    int txPerBlock = argc > 2 ? std::stoi(argv[2]) : 20;
+    int rounds = argc > 3 ? std::stoi(argv[3]) : 20;
+
+    // 钱包、交易和区块的调试输出太多，构造链期间关闭
+    std::cout.setstate(std::ios::failbit);
+
+    std::vector<std::unique_ptr<Wallet>> wallets;
+    for (int i = 0; i < WALLET_COUNT; ++i) {
+        wallets.push_back(std::make_unique<Wallet>());
+    }
+
+    // 与真实链相同的形状：每块一笔出块奖励，其余为带找零输出的签名转账
+    std::mt19937 rng(12345);
+    std::vector<std::string> blocks;
+    std::string previousHash = "0";
+    for (int b = 0; b < blockCount; ++b) {
+        std::vector<Transaction> transactions;
+        transactions.push_back(Transaction::createSystemTransaction(wallets[b % WALLET_COUNT]->getPublicKey(), 50.0));
+        for (int t = 0; t < txPerBlock; ++t) {
+            const Wallet& from = *wallets[rng() % WALLET_COUNT];
+            const Wallet& to = *wallets[rng() % WALLET_COUNT];
+            double amount = 1.0 + rng() % 1000 / 100.0;
+            Transaction tx(from.getPublicKey(), to.getPublicKey(), amount, 0.01);
+            tx.addInput(TransactionInput(previousHash, t, ""));
+            tx.addOutput(TransactionOutput(amount, to.getPublicKey()));
+            tx.addOutput(TransactionOutput(5.0, from.getPublicKey()));
+            tx.setSignature(from.sign(tx.toJson()));
+            transactions.push_back(tx);
+        }
+        Block block(b, transactions, previousHash);
+        previousHash = block.getHash();
+        blocks.push_back(block.toJson());
+    }
+
+    // BLOCKS 消息：连续区块组成的 JSON 数组
+    std::vector<std::string> chunks;
+    for (size_t i = 0; i < blocks.size(); i += BLOCKS_PER_CHUNK) {
+        std::string chunk = "[";
+        for (size_t j = i; j < blocks.size() && j < i + BLOCKS_PER_CHUNK; ++j) {
+            if (j > i) {
+                chunk += ",";
+            }
+            chunk += blocks[j];
+        }
+        chunks.push_back(chunk + "]");
+    }
+
+    Result blockResult;
+    Result chunkResult;
+    bool ok = measure(blocks, rounds, blockResult) && measure(chunks, rounds, chunkResult);
+
+    std::cout.clear();
+    if (!ok) {
+        std::cerr << "compression_bench: decompressed data does not match the input" << std::endl;
+        return 1;
+    }
+    std::cout << "compression_bench: " << blockCount << " blocks x " << txPerBlock + 1 << " transactions, "
+              << rounds << " decode rounds" << std::endl;
+    report("  block records", blocks.size(), blockResult, rounds);
+    report("  BLOCKS chunks", chunks.size(), chunkResult, rounds);
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Merkle树基准：对不同叶子数分别串行和并行构建整棵树（含证明路径），比较耗时并检查根一致。
+// 串行通过把并行阈值设为最大值得到；单核机器上并行路径不会启用。
+// 用法：merkle_bench [轮数] [叶子数...]，默认 1000 10000 100000
+#include "merkletree.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 取多轮中最快的一次，减少调度和缓存预热的干扰
+static double bestMillis(const std::vector<Transaction>& transactions, int rounds, std::string& rootHash) {
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < rounds; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        MerkleTree tree(transactions);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, elapsed);
+        rootHash = tree.getRootHash();
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? std::stoi(argv[1]) : 3;
+    std::vector<size_t> sizes;
+    for (int i = 2; i < argc; ++i) {
+        sizes.push_back(std::stoul(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = {1000, 10000, 100000};
+    }
+
+    std::cout << "merkle_bench: " << std::thread::hardware_concurrency() << " hardware threads, parallel threshold "
+              << MerkleTree::DEFAULT_PARALLEL_THRESHOLD << " nodes, best of " << rounds << " rounds" << std::endl;
+    bool ok = true;
+    for (size_t size : sizes) {
+        // 交易和树的调试输出太多，计时期间关闭
+        std::cout.setstate(std::ios::failbit);
+        std::vector<Transaction> transactions;
+        transactions.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            transactions.push_back(Transaction::createSystemTransaction("bench", static_cast<double>(i + 1)));
+        }
+
+        std::string serialRoot;
+        std::string parallelRoot;
+        MerkleTree::setParallelThreshold(std::numeric_limits<size_t>::max());
+        double serial = bestMillis(transactions, rounds, serialRoot);
+        MerkleTree::setParallelThreshold(MerkleTree::DEFAULT_PARALLEL_THRESHOLD);
+        double parallel = bestMillis(transactions, rounds, parallelRoot);
+        std::cout.clear();
+
+        std::cout << "  " << size << " leaves: serial " << serial << " ms, parallel " << parallel
+                  << " ms, speedup " << serial / parallel << std::endl;
+        if (serialRoot != parallelRoot) {
+            std::cerr << "merkle_bench: serial and parallel roots differ for " << size << " leaves" << std::endl;
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -37,11 +37,9 @@ Block::Block(const json& json) {
     nonce_ = json["nonce"];
     merkleRoot_ = json["merkleRoot"];
     
-    // 解析交易
+    // 解析交易（完整恢复交易ID、输入和输出，保证Merkle根可以重新计算）
     for (const auto& txJson : json["transactions"]) {
-        Transaction tx(txJson["from"], txJson["to"], txJson["amount"]);
-        tx.setSignature(txJson["signature"]);
-        transactions_.push_back(tx);
+        transactions_.push_back(Transaction(txJson));
     }
     
     // 解析余额变更
@@ -79,26 +77,131 @@ std::string Block::calculateHash() const {
     return sha256(ss.str());
 }
 
+// 区块头的哈希与 Block::calculateHash 完全一致，不需要交易就能验证
+std::string BlockHeader::calculateHash() const {
+    std::stringstream ss;
+    ss << index << timestamp << merkleRoot << previousHash << nonce;
+    return Block::sha256(ss.str());
+}
+
+bool BlockHeader::verifyDifficulty(int difficulty) const {
+    return hash.substr(0, difficulty) == std::string(difficulty, '0');
+}
+
+BlockHeader::BlockHeader(const json& json) {
+    index = json["index"];
+    timestamp = json["timestamp"];
+    previousHash = json["previousHash"];
+    hash = json["hash"];
+    nonce = json["nonce"];
+    merkleRoot = json["merkleRoot"];
+    transactionCount = json["transactionCount"];
+}
+
+std::string BlockHeader::toJson() const {
+    json j;
+    j["index"] = index;
+    j["timestamp"] = timestamp;
+    j["previousHash"] = previousHash;
+    j["hash"] = hash;
+    j["nonce"] = nonce;
+    j["merkleRoot"] = merkleRoot;
+    j["transactionCount"] = transactionCount;
+    return j.dump();
+}
+
+BlockHeader Block::getHeader() const {
+    BlockHeader header;
+    header.index = index_;
+    header.timestamp = timestamp_;
+    header.previousHash = previousHash_;
+    header.hash = hash_;
+    header.nonce = nonce_;
+    header.merkleRoot = merkleRoot_;
+    header.transactionCount = transactions_.size();
+    return header;
+}
+
+size_t Block::estimateSize() const {
+    size_t bytes = sizeof(Block) + timestamp_.size() + previousHash_.size() + hash_.size() + merkleRoot_.size();
+    for (const auto& tx : transactions_) {
+        bytes += sizeof(Transaction) + tx.getFrom().size() + tx.getTo().size()
+               + tx.getTimestamp().size() + tx.getTransactionId().size() + tx.getSignature().size();
+        for (const auto& input : tx.getInputs()) {
+            bytes += sizeof(TransactionInput) + input.getTxId().size() + input.getSignature().size();
+        }
+        for (const auto& output : tx.getOutputs()) {
+            bytes += sizeof(TransactionOutput) + output.getOwner().size();
+        }
+    }
+    for (const auto& [address, change] : balanceChanges_) {
+        bytes += address.size() + sizeof(change) + 32;  // 32 为 map 节点开销的估计
+    }
+    return bytes;
+}
+
 
 // 不断尝试不同的 nonce，直到当前计算出的哈希 hash 的前 difficulty 位是 "0000"；
 // 这就模拟了"挖矿"的过程（寻找满足条件的哈希）。
 void Block::mineBlock(int difficulty) {
+    mineBlock(difficulty, nullptr, std::chrono::milliseconds(0));
+}
+
+void Block::mineBlock(int difficulty, const TemplateRefresh& refresh, std::chrono::milliseconds refreshInterval) {
     std::cout << index_ << " Block mined: " << merkleRoot_ << std::endl;
 
+    // 每尝试这么多个 nonce 才看一次时钟，避免拖慢哈希循环
+    const int CLOCK_CHECK_NONCES = 1024;
+    auto nextRefresh = std::chrono::steady_clock::now() + refreshInterval;
     std::string target(difficulty, '0');
     while (hash_.substr(0, difficulty) != target) {
         nonce_++;
         hash_ = calculateHash();
+        if (refresh && nonce_ % CLOCK_CHECK_NONCES == 0 && std::chrono::steady_clock::now() >= nextRefresh) {
+            auto added = refresh(*this);
+            if (!added.empty()) {
+                std::cout << index_ << " Block template refreshed: +" << added.size()
+                          << " transactions, restarting nonce search" << std::endl;
+                appendTransactions(added);
+            }
+            nextRefresh = std::chrono::steady_clock::now() + refreshInterval;
+        }
     }
     std::cout << "Block mined: " << hash_ << std::endl;
 }
 
+void Block::appendTransactions(const std::vector<Transaction>& transactions) {
+    // 累加器只能追加，移除末尾的手续费交易后从头重建
+    if (!transactions_.empty() && transactions_.back().isFeeTransaction()) {
+        transactions_.pop_back();
+        merkleAccumulator_.reset();
+    }
+    // 累加器只保存右侧边界，之后每追加一笔交易只需 O(log n) 次哈希
+    if (!merkleAccumulator_) {
+        merkleAccumulator_.emplace();
+        for (const auto& tx : transactions_) {
+            merkleAccumulator_->append(tx.getTransactionId());
+        }
+    }
+    for (const auto& tx : transactions) {
+        merkleAccumulator_->append(tx.getTransactionId());
+        transactions_.push_back(tx);
+    }
+    merkleRoot_ = merkleAccumulator_->getRootHash();
+    nonce_ = 0;
+    hash_ = calculateHash();
+}
+
 // 验证当前区块的哈希是否与计算出的哈希一致
 bool Block::isValid() const {
     return hash_ == calculateHash();
 }
 
 std::string Block::toJson() const {
+    return toJsonObject().dump();
+}
+
+json Block::toJsonObject() const {
     json j;
     j["index"] = index_;
     j["timestamp"] = timestamp_;
@@ -110,7 +213,7 @@ std::string Block::toJson() const {
     // 添加交易
     json transactions = json::array();
     for (const auto& tx : transactions_) {
-        transactions.push_back(json::parse(tx.toJson()));
+        transactions.push_back(tx.toJsonObject());
     }
     j["transactions"] = transactions;
     
@@ -121,7 +224,7 @@ std::string Block::toJson() const {
     }
     j["balanceChanges"] = balanceChanges;
     
-    return j.dump();
+    return j;
 }
 
 bool Block::verifyDifficulty(int difficulty) const {
@@ -3,10 +3,32 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <chrono>
+#include <optional>
 #include "transaction.h"
 #include "merkletree.h"
 #include <nlohmann/json.hpp>
 
+// 区块头：链上每个区块常驻内存的紧凑部分，不包含交易
+struct BlockHeader {
+    BlockHeader() = default;
+    BlockHeader(const nlohmann::json& json);
+
+    int index = 0;
+    std::string timestamp;
+    std::string previousHash;
+    std::string hash;
+    int nonce = 0;
+    std::string merkleRoot;
+    size_t transactionCount = 0;
+
+    std::string calculateHash() const;
+    bool verifyDifficulty(int difficulty) const;
+    // 区块头的 JSON 形式（用于区块头优先同步）
+    std::string toJson() const;
+};
+
 class Block {
 public:
     Block(int index, const std::vector<Transaction>& transactions, const std::string& previousHash);
@@ -14,6 +36,17 @@ public:
     
     std::string calculateHash() const;
     void mineBlock(int difficulty);
+    // 挖矿期间的模板刷新：返回要追加到区块末尾的新交易，为空表示保持不变
+    using TemplateRefresh = std::function<std::vector<Transaction>(const Block&)>;
+    // 每隔 refreshInterval 调用一次 refresh，追加了交易就重新计算Merkle根并从头搜索 nonce
+    void mineBlock(int difficulty, const TemplateRefresh& refresh, std::chrono::milliseconds refreshInterval);
+    // 在末尾追加交易（只用于挖矿中的区块），重新计算Merkle根和哈希，nonce 归零。
+    // 手续费交易必须是区块的最后一笔：区块末尾已有手续费交易时先移除它，新的手续费交易由调用者放在 transactions 末尾
+    void appendTransactions(const std::vector<Transaction>& transactions);
+    // 提取区块头
+    BlockHeader getHeader() const;
+    // 估算区块在内存中占用的字节数（用于缓存预算）
+    size_t estimateSize() const;
     bool isValid() const;
     
     // Getters
@@ -29,6 +62,8 @@ public:
 
     // 将区块转换为 JSON 字符串
     std::string toJson() const;
+    // JSON 对象形式，拼装更大的消息时不必先序列化再解析
+    nlohmann::json toJsonObject() const;
     bool verifyDifficulty(int difficulty) const;
 private:
 
@@ -41,6 +76,9 @@ private:
     std::string hash_;
     int nonce_;
     std::string merkleRoot_;
+    // 挖矿中追加交易时使用的Merkle累加器，第一次追加时建立
+    std::optional<MerkleAccumulator> merkleAccumulator_;
 
     static std::string sha256(const std::string& str);
+    friend struct BlockHeader;
 }; 
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "blockcache.h"
+#include <iostream>
+
+BlockCache::BlockCache(size_t maxBytes)
+    : maxBytes_(maxBytes)
+    , usedBytes_(0)
+{
+}
+
+std::shared_ptr<Block> BlockCache::get(int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = lookup_.find(height);
+    if (it == lookup_.end()) {
+        return nullptr;
+    }
+    // 移到表头
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->block;
+}
+
+void BlockCache::put(int height, const std::shared_ptr<Block>& block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = lookup_.find(height);
+    if (it != lookup_.end()) {
+        usedBytes_ -= it->second->bytes;
+        entries_.erase(it->second);
+        lookup_.erase(it);
+    }
+
+    size_t bytes = block->estimateSize();
+    entries_.push_front({height, block, bytes});
+    lookup_[height] = entries_.begin();
+    usedBytes_ += bytes;
+    evict();
+}
+
+void BlockCache::erase(int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = lookup_.find(height);
+    if (it == lookup_.end()) {
+        return;
+    }
+    usedBytes_ -= it->second->bytes;
+    entries_.erase(it->second);
+    lookup_.erase(it);
+}
+
+void BlockCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lookup_.clear();
+    usedBytes_ = 0;
+}
+
+void BlockCache::setMaxBytes(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxBytes_ = maxBytes;
+    evict();
+}
+
+size_t BlockCache::getMaxBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxBytes_;
+}
+
+size_t BlockCache::getUsedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return usedBytes_;
+}
+
+size_t BlockCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void BlockCache::evict() {
+    if (maxBytes_ == 0) {
+        return;
+    }
+    // 至少保留最近使用的一个区块，即使它本身超过预算
+    while (usedBytes_ > maxBytes_ && entries_.size() > 1) {
+        const Entry& victim = entries_.back();
+        usedBytes_ -= victim.bytes;
+        lookup_.erase(victim.height);
+        entries_.pop_back();
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "block.h"
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+
+// 区块体的LRU缓存，按字节预算淘汰最久未使用的区块
+// 预算为 0 表示不淘汰（没有区块存储时区块体只能常驻内存）
+class BlockCache {
+public:
+    BlockCache(size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    std::shared_ptr<Block> get(int height);
+    void put(int height, const std::shared_ptr<Block>& block);
+    void erase(int height);
+    void clear();
+
+    void setMaxBytes(size_t maxBytes);
+    size_t getMaxBytes() const;
+    size_t getUsedBytes() const;
+    size_t size() const;
+
+    static const size_t DEFAULT_MAX_BYTES = 32 * 1024 * 1024;
+
+private:
+    struct Entry {
+        int height;
+        std::shared_ptr<Block> block;
+        size_t bytes;
+    };
+
+    size_t maxBytes_;
+    size_t usedBytes_;
+    std::list<Entry> entries_;                                   // 表头为最近使用
+    std::unordered_map<int, std::list<Entry>::iterator> lookup_; // 高度 -> 链表节点
+    mutable std::mutex mutex_;
+
+    void evict();
+};
@@ -5,15 +5,92 @@
 #include <map>
 #include <chrono>
 #include <mutex>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <set>
+#include <cmath>
 
 // Blockchain 类实现
-Blockchain::Blockchain(int difficulty)
-    : difficulty_(difficulty)
+Blockchain::Blockchain(int difficulty, const std::string& dataDir)
+    : blockCache_(0)
+    , difficulty_(difficulty)
 {
+    if (!dataDir.empty()) {
+        blockStore_ = std::make_unique<BlockStore>(dataDir);
+        if (!blockStore_->open()) {
+            std::cout << "Blockchain::Blockchain block store unavailable, running in memory" << std::endl;
+            blockStore_.reset();
+        } else {
+            // 区块体可以从存储重新加载，缓存才需要预算
+            blockCache_.setMaxBytes(BlockCache::DEFAULT_MAX_BYTES);
+            if (loadFromStore()) {
+                return;
+            }
+        }
+    }
+
 	std::cout << "Blockchain::Blockchain createGenesisBlock" << std::endl;
 
     auto genesisBlock = createGenesisBlock();
-    chain_.push_back(genesisBlock);
+    connectBlock(genesisBlock);
+}
+
+Blockchain::~Blockchain() {
+    // 正常关闭：记录已验证的高度，下次启动时这些区块不再重新验证
+    if (blockStore_ && getBlockCount() > 0) {
+        blockStore_->setValidatedHeight(getBlockCount() - 1);
+    }
+}
+
+bool Blockchain::loadFromStore() {
+    int count = blockStore_->getBlockCount();
+    if (count == 0) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int validatedHeight = blockStore_->getValidatedHeight();
+    int verified = 0;
+    // 修剪过的存储先从 chainstate 恢复区块头和UTXO集合，再重放其后仍保留的区块
+    int firstHeight = 0;
+    if (blockStore_->getPruneHeight() > 0) {
+        if (!loadChainState(count)) {
+            throw std::runtime_error("pruned block store in " + blockStore_->getDirectory() +
+                                     " has no usable chain state");
+        }
+        firstHeight = getBlockCount();
+    }
+    for (int height = firstHeight; height < count; ++height) {
+        auto block = blockStore_->readBlock(height);
+        // 创世区块和上次正常关闭前已验证的区块只检查校验和，其余区块完整验证
+        if (block && height > 0 && height > validatedHeight) {
+            if (verifyBlock(*block)) {
+                verified++;
+            } else {
+                block = nullptr;
+            }
+        }
+        if (!block) {
+            std::cout << "Blockchain::loadFromStore invalid block at height " << height << ", discarding the rest" << std::endl;
+            blockStore_->truncate(height);
+            break;
+        }
+        connectBlock(block, false);
+    }
+    if (getBlockCount() == 0) {
+        return false;
+    }
+    blockStore_->setValidatedHeight(getBlockCount() - 1);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "Blockchain::loadFromStore loaded " << getBlockCount() << " blocks ("
+              << verified << " verified) in " << elapsed << " ms, "
+              << blockStore_->getTotalBytes() / getBlockCount() << " bytes/block" << std::endl;
+    return true;
 }
 
 std::shared_ptr<Block> Blockchain::createGenesisBlock() {
@@ -37,39 +114,484 @@ std::shared_ptr<Block> Blockchain::createGenesisBlock() {
     return std::make_shared<Block>(0, genesisTransactions, uniqueId);
 }
 
+// 区块中交易的手续费合计，以及其中输入/输出交易的部分（作为手续费交易的输出）
+static void sumFees(const std::vector<Transaction>& transactions, double& fees, double& outputFees) {
+    fees = 0.0;
+    outputFees = 0.0;
+    for (const auto& tx : transactions) {
+        if (tx.getFrom() == "SYSTEM") {
+            continue;
+        }
+        fees += tx.getFee();
+        if (!tx.getInputs().empty() || !tx.getOutputs().empty()) {
+            outputFees += tx.getFee();
+        }
+    }
+}
+
+// 交易有手续费时，在末尾追加一笔把它们的手续费付给出块者的交易。
+// 未设置出块者地址时付给 SYSTEM，即销毁；有手续费的区块必须有且只有一笔手续费交易
+static void appendFeeTransaction(std::vector<Transaction>& transactions, const std::string& miner, int height) {
+    double fees;
+    double outputFees;
+    sumFees(transactions, fees, outputFees);
+    if (fees <= 0.0) {
+        return;
+    }
+    if (miner.empty()) {
+        std::cout << "  appendFeeTransaction: no miner address, fees " << fees << " are burned" << std::endl;
+    }
+    transactions.push_back(Transaction::createFeeTransaction(miner.empty() ? "SYSTEM" : miner, fees, outputFees,
+                                                             height, static_cast<int>(transactions.size())));
+}
+
 void Blockchain::addBlock(const std::vector<Transaction>& transactions, bool usePendingTxs) {
-    std::vector<Transaction> blockTransactions;
-    
-    if (usePendingTxs) {
-        // 使用链上的待处理交易
-        blockTransactions = getPendingTransactions();
-    } else {
-        // 使用传入的交易
-        blockTransactions = transactions;
+    // 挖矿不持有写锁：基于链尾快照出块，接入前链尾已经变化（其他节点的区块先接入）就重新出块
+    bool retry = false;
+    while (true) {
+        std::vector<Transaction> blockTransactions;
+        if (usePendingTxs) {
+            // 按区块模板策略从交易池选取交易，积压的交易留给后续区块。
+            // 重新出块时也要重新选取：先接入的区块已经确认并从交易池移除了其中一部分交易
+            blockTransactions = createBlockTemplate().transactions;
+        } else {
+            // 使用传入的交易
+            blockTransactions = transactions;
+        }
+        auto snapshot = getSnapshot();
+        // 手续费交易记录区块高度，链尾变化后重新出块时要重新生成
+        appendFeeTransaction(blockTransactions, getMinerAddress(), snapshot->getBlockCount());
+        auto newBlock = std::make_shared<Block>(
+            snapshot->getBlockCount(),
+            blockTransactions,
+            snapshot->empty() ? "0" : snapshot->getTip().hash
+        );
+        
+        // 挖矿；打包交易池的交易时，挖矿期间到达的交易可以追加进这个区块
+        std::cout << "  mineBlock: " << newBlock->getHash() << std::endl;
+        if (usePendingTxs && templatePolicy_.refreshIntervalMs > 0) {
+            newBlock->mineBlock(difficulty_,
+                [this](const Block& block) { return refreshBlockTemplate(block); },
+                std::chrono::milliseconds(templatePolicy_.refreshIntervalMs));
+        } else {
+            newBlock->mineBlock(difficulty_);
+        }
+        
+        std::lock_guard<std::mutex> lock(chainMutex_);
+        if (getBlockCount() != snapshot->getBlockCount()) {
+            std::cout << "  addBlock: chain tip moved while mining, rebuilding block" << std::endl;
+            retry = true;
+            continue;
+        }
+        // 传入的交易可能已被先接入的区块确认，重新出块后要按新的链状态检查，不能重复应用
+        if (retry && !usePendingTxs && !checkBlockContext(*newBlock)) {
+            std::cout << "  addBlock: transactions are no longer valid on the new tip, block dropped" << std::endl;
+            return;
+        }
+        // 添加区块到链上 
+        std::cout << "  addBlock: " << newBlock->getHash() << std::endl;
+        connectBlock(newBlock);
+        break;
     }
-    
-    // 创建新区块
-    auto newBlock = std::make_shared<Block>(
-        chain_.size(),
-        blockTransactions,
-        chain_.empty() ? "0" : chain_.back()->getHash()
-    );
-    
-    // 挖矿
-    std::cout << "  mineBlock: " << newBlock->getHash() << std::endl;
-    newBlock->mineBlock(difficulty_);
-    
-    // 添加区块到链上 
-    std::cout << "  addBlock: " << newBlock->getHash() << std::endl;
-    chain_.push_back(newBlock);
-    // 更新UTXO池
-    std::cout << "  updateUTXOPool: " << newBlock->getHash() << std::endl;
-    updateUTXOPool(*newBlock);
-    
-    // 清理已处理的交易
-    if (usePendingTxs) {
-        clearPendingTransactions();
+}
+
+void Blockchain::connectBlock(const std::shared_ptr<Block>& block, bool persist) {
+    // 余额变更由本节点根据UTXO集合计算，不信任区块里带来的值；要在写入存储之前完成
+    block->setBalanceChanges(computeBalanceChanges(*block));
+    if (persist && blockStore_ && !blockStore_->writeBlock(*block)) {
+        // 没写进存储的区块体不能交给LRU淘汰，否则之后再也加载不到
+        std::cout << "  connectBlock: failed to persist block " << block->getIndex() << ", keeping it in memory" << std::endl;
+        std::lock_guard<std::mutex> lock(unpersistedMutex_);
+        unpersistedBlocks_[block->getIndex()] = block;
     }
+    if (txIndex_) {
+        txIndex_->addBlock(*block);
+    }
+    addressIndex_.addBlock(*block);
+    blockCache_.put(block->getIndex(), block);
+    {
+        // getBalance 持有余额锁读取UTXO池；从更新UTXO池到发布新版本一直持有它，
+        // 余额查询不会看到已更新但尚未发布的UTXO池
+        std::lock_guard<std::mutex> balanceLock(balances_mutex_);
+        // 更新UTXO池
+        std::cout << "  updateUTXOPool: " << block->getHash() << std::endl;
+        updateUTXOPool(*block);
+        // 无论区块来自本地挖矿、共识还是同步，都只移除被确认和因此失效的交易，没选中的交易留给下一个区块
+        transactionPool_.removeForBlock(block->getTransactions(), utxoPool_);
+        balanceHistory_.addBlock(*block);
+        // 余额发生变化的地址的缓存失效
+        for (const auto& [address, change] : block->getBalanceChanges()) {
+            balances_.erase(address);
+        }
+        {
+            std::unique_lock<std::shared_mutex> lock(heightByHashMutex_);
+            heightByHash_[block->getHash()] = block->getIndex();
+        }
+        // 区块体和索引都就绪后才发布新版本，读者从快照拿到的高度和哈希总是能查到区块；
+        // 新版本的UTXO视图只复制本区块触及的分桶
+        auto previous = getSnapshot();
+        std::atomic_store(&snapshot_, ChainSnapshot::append(previous, block->getHeader(), utxoPool_.getCommitment(),
+                                                            UTXOSetView::apply(previous->getUTXOs(), block->getTransactions())));
+    }
+    if (persist && pruneBudget_ > 0) {
+        pruneBlockStore();
+    }
+}
+
+std::map<std::string, double> Blockchain::computeBalanceChanges(const Block& block) const {
+    std::map<std::string, double> changes;
+    // 同一区块内先创建后花费的输出还不在UTXO池里
+    std::map<std::pair<std::string, int>, TransactionOutput> createdInBlock;
+    for (const auto& tx : block.getTransactions()) {
+        if (tx.getInputs().empty() && tx.getOutputs().empty()) {
+            // 手续费也从发送方扣除，由区块里的手续费交易付给出块者
+            if (tx.getFrom() != "SYSTEM") {
+                changes[tx.getFrom()] -= tx.getAmount() + tx.getFee();
+            }
+            changes[tx.getTo()] += tx.getAmount();
+            continue;
+        }
+        for (const auto& input : tx.getInputs()) {
+            auto created = createdInBlock.find({input.getTxId(), input.getOutputIndex()});
+            if (created != createdInBlock.end()) {
+                changes[created->second.getOwner()] -= created->second.getAmount();
+                continue;
+            }
+            UTXO spent;
+            if (utxoPool_.findUTXO(input.getTxId(), input.getOutputIndex(), spent)) {
+                changes[spent.getOwner()] -= spent.getAmount();
+            }
+        }
+        // 输入/输出交易的手续费是输入与输出的差额，已经随输入从发送方扣除
+        const auto& outputs = tx.getOutputs();
+        double outputTotal = 0.0;
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            changes[outputs[i].getOwner()] += outputs[i].getAmount();
+            outputTotal += outputs[i].getAmount();
+            createdInBlock.emplace(std::make_pair(tx.getTransactionId(), static_cast<int>(i)), outputs[i]);
+        }
+        // 手续费交易中没有对应输出的部分是普通交易的手续费，只记入余额变更
+        if (tx.getFrom() == "SYSTEM" && tx.getAmount() > outputTotal) {
+            changes[tx.getTo()] += tx.getAmount() - outputTotal;
+        }
+    }
+    for (auto it = changes.begin(); it != changes.end();) {
+        if (it->second == 0.0) {
+            it = changes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return changes;
+}
+
+double Blockchain::getBalanceAtHeight(const std::string& address, int height) const {
+    return balanceHistory_.getBalanceAt(address, height);
+}
+
+std::shared_ptr<const ChainSnapshot> Blockchain::getSnapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+std::shared_ptr<Block> Blockchain::getBlockByHash(const std::string& hash) const {
+    int height = getHeightByHash(hash);
+    if (height < 0) {
+        return nullptr;
+    }
+    return getBlockByHeight(height);
+}
+
+std::shared_ptr<Block> Blockchain::getBlockByHeight(int height) const {
+    if (height < 0 || height >= getBlockCount()) {
+        return nullptr;
+    }
+    auto block = blockCache_.get(height);
+    if (!block) {
+        std::lock_guard<std::mutex> lock(unpersistedMutex_);
+        auto it = unpersistedBlocks_.find(height);
+        if (it != unpersistedBlocks_.end()) {
+            return it->second;
+        }
+    }
+    if (!block && blockStore_) {
+        // 缓存未命中时从存储加载区块体
+        block = blockStore_->readBlock(height);
+        if (block) {
+            blockCache_.put(height, block);
+        }
+    }
+    return block;
+}
+
+bool Blockchain::enablePruning(uint64_t diskBudgetBytes, int keepDepth) {
+    std::lock_guard<std::mutex> lock(chainMutex_);
+    if (!blockStore_) {
+        std::cout << "enablePruning: no block store, nothing to prune" << std::endl;
+        return false;
+    }
+    if (txIndex_) {
+        std::cout << "enablePruning: pruning is incompatible with the transaction index" << std::endl;
+        return false;
+    }
+    pruneBudget_ = diskBudgetBytes;
+    pruneKeepDepth_ = std::max(keepDepth, 1);
+    std::cout << "enablePruning: budget " << pruneBudget_ << " bytes, keeping the last "
+              << pruneKeepDepth_ << " blocks" << std::endl;
+    pruneBlockStore();
+    return true;
+}
+
+int Blockchain::getPruneHeight() const {
+    return blockStore_ ? blockStore_->getPruneHeight() : 0;
+}
+
+void Blockchain::pruneBlockStore() {
+    if (blockStore_->getTotalBytes() <= pruneBudget_) {
+        return;
+    }
+    int target = blockStore_->getPrunableHeight(getBlockCount() - pruneKeepDepth_, pruneBudget_);
+    if (target <= blockStore_->getPruneHeight()) {
+        return;
+    }
+    // 先保存修剪后无法再重建的状态，再删除区块体
+    if (!writeChainState()) {
+        std::cout << "pruneBlockStore: failed to write chain state, not pruning" << std::endl;
+        return;
+    }
+    blockStore_->pruneBelow(target);
+    for (int height = 0; height < target; ++height) {
+        blockCache_.erase(height);
+    }
+}
+
+std::string Blockchain::chainStatePath() const {
+    return (std::filesystem::path(blockStore_->getDirectory()) / "chainstate.json").string();
+}
+
+bool Blockchain::writeChainState() const {
+    auto snapshot = getSnapshot();
+    json state;
+    state["height"] = snapshot->getBlockCount() - 1;
+    state["headers"] = json::array();
+    state["commitments"] = json::array();
+    for (int height = 0; height < snapshot->getBlockCount(); ++height) {
+        state["headers"].push_back(json::parse(snapshot->getHeader(height).toJson()));
+        state["commitments"].push_back(snapshot->getUTXOCommitment(height));
+    }
+    state["utxos"] = json::array();
+    for (const auto& utxo : utxoPool_.getAllUTXOs()) {
+        state["utxos"].push_back(json::parse(utxo.toJson()));
+    }
+
+    // 写临时文件后改名，崩溃时旧的 chainstate 保持完整
+    std::string path = chainStatePath();
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        out << state.dump();
+        out.flush();
+        if (!out) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    return !ec;
+}
+
+bool Blockchain::loadChainState(int blockCount) {
+    std::ifstream in(chainStatePath());
+    if (!in) {
+        std::cout << "loadChainState: " << chainStatePath() << " is missing" << std::endl;
+        return false;
+    }
+    json state;
+    try {
+        state = json::parse(in);
+    } catch (const std::exception& e) {
+        std::cout << "loadChainState: " << e.what() << std::endl;
+        return false;
+    }
+
+    int height = state["height"];
+    if (height + 1 < blockStore_->getPruneHeight() || height >= blockCount) {
+        std::cout << "loadChainState: chain state at height " << height << " does not match the store" << std::endl;
+        return false;
+    }
+    std::vector<BlockHeader> headers;
+    std::vector<std::string> commitments;
+    for (const auto& headerJson : state["headers"]) {
+        headers.emplace_back(headerJson);
+    }
+    for (const auto& commitment : state["commitments"]) {
+        commitments.push_back(commitment);
+    }
+    for (const auto& utxoJson : state["utxos"]) {
+        utxoPool_.addUTXO(UTXO(utxoJson));
+    }
+
+    // 区块头与存储索引一致，UTXO集合与保存的承诺一致
+    bool valid = static_cast<int>(headers.size()) == height + 1 &&
+                 static_cast<int>(commitments.size()) == height + 1 &&
+                 headers.back().hash == blockStore_->getLocation(height).hash &&
+                 utxoPool_.getCommitment() == commitments.back();
+    if (!valid) {
+        std::cout << "loadChainState: chain state is inconsistent" << std::endl;
+        return false;
+    }
+    for (const auto& header : headers) {
+        heightByHash_[header.hash] = header.index;
+    }
+    std::atomic_store(&snapshot_, ChainSnapshot::build(headers, commitments, UTXOSetView::build(utxoPool_.getAllUTXOs())));
+    std::cout << "loadChainState: restored " << headers.size() << " headers and "
+              << state["utxos"].size() << " UTXOs" << std::endl;
+    return true;
+}
+
+void Blockchain::setBlockCacheBudget(size_t maxBytes) {
+    if (blockStore_) {
+        blockCache_.setMaxBytes(maxBytes);
+    }
+}
+
+bool Blockchain::enableTxIndex() {
+    std::lock_guard<std::mutex> lock(chainMutex_);
+    if (txIndex_) {
+        return true;
+    }
+    if (getPruneHeight() > 0 || pruneBudget_ > 0) {
+        std::cout << "Blockchain::enableTxIndex transaction index is unavailable on a pruned node" << std::endl;
+        return false;
+    }
+    std::string path;
+    if (blockStore_) {
+        path = (std::filesystem::path(blockStore_->getDirectory()) / "txindex.dat").string();
+    }
+    auto index = std::make_unique<TxIndex>(path);
+    if (!index->open()) {
+        return false;
+    }
+
+    // 丢弃链上已不存在的区块（启动时可能截断过存储），补齐还没有索引的区块
+    index->truncate(getBlockCount());
+    int indexed = index->getBlockCount();
+    for (int height = indexed; height < getBlockCount(); ++height) {
+        auto block = getBlockByHeight(height);
+        if (!block || !index->addBlock(*block)) {
+            std::cout << "Blockchain::enableTxIndex failed to index block " << height << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Blockchain::enableTxIndex " << index->size() << " transactions indexed ("
+              << getBlockCount() - indexed << " blocks caught up)" << std::endl;
+    txIndex_ = std::move(index);
+    return true;
+}
+
+bool Blockchain::getTransaction(const std::string& txId, Transaction& tx, TxLocation* location) const {
+    if (!txIndex_) {
+        std::cout << "getTransaction: transaction index is disabled" << std::endl;
+        return false;
+    }
+    TxLocation found;
+    if (!txIndex_->find(txId, found)) {
+        return false;
+    }
+    if (location) {
+        *location = found;
+    }
+
+    // 区块不在缓存中时只从存储读取这一笔交易的字节
+    auto block = blockCache_.get(found.height);
+    if (!block && blockStore_) {
+        std::string data;
+        if (blockStore_->readRange(found.height, found.byteOffset, found.size, data)) {
+            try {
+                Transaction stored(json::parse(data));
+                if (stored.getTransactionId() == txId) {
+                    tx = stored;
+                    return true;
+                }
+            } catch (const std::exception& e) {
+                std::cout << "getTransaction: bad transaction record: " << e.what() << std::endl;
+            }
+        }
+    }
+    if (!block) {
+        block = getBlockByHeight(found.height);
+    }
+    if (!block || found.position >= block->getTransactions().size()) {
+        return false;
+    }
+    tx = block->getTransactions()[found.position];
+    return tx.getTransactionId() == txId;
+}
+
+bool Blockchain::getTransactionProof(const std::string& txId, std::vector<std::pair<std::string, bool>>& proof,
+                                     std::string& merkleRoot) const {
+    TxLocation location;
+    if (!txIndex_ || !txIndex_->find(txId, location)) {
+        return false;
+    }
+    auto snapshot = getSnapshot();
+    auto block = getBlockByHeight(location.height);
+    if (!block || location.height >= snapshot->getBlockCount()) {
+        return false;
+    }
+    MerkleTree merkleTree(block->getTransactions());
+    merkleRoot = snapshot->getHeader(location.height).merkleRoot;
+    return merkleTree.getProof(txId, proof);
+}
+
+// 游标格式："c:<高度>:<下标>" 指向已确认交易，"p:<序号>" 指向待处理交易
+static std::string makeHistoryCursor(const AddressHistoryEntry& entry) {
+    if (entry.height < 0) {
+        return "p:" + std::to_string(entry.position);
+    }
+    return "c:" + std::to_string(entry.height) + ":" + std::to_string(entry.position);
+}
+
+AddressHistoryPage Blockchain::getAddressHistory(const std::string& address, const std::string& cursor,
+                                                 size_t limit) const {
+    AddressHistoryPage page;
+    bool inPending = false;
+    int afterHeight = -1;
+    uint64_t afterPosition = 0;
+    uint64_t afterSequence = 0;
+    try {
+        if (cursor.rfind("p:", 0) == 0) {
+            inPending = true;
+            afterSequence = std::stoull(cursor.substr(2));
+        } else if (cursor.rfind("c:", 0) == 0) {
+            size_t separator = cursor.find(':', 2);
+            afterHeight = std::stoi(cursor.substr(2, separator - 2));
+            afterPosition = std::stoull(cursor.substr(separator + 1));
+        } else if (!cursor.empty()) {
+            throw std::invalid_argument(cursor);
+        }
+    } catch (const std::exception&) {
+        std::cout << "getAddressHistory: invalid cursor " << cursor << std::endl;
+        return page;
+    }
+
+    // 多取一条用来判断是否还有下一页
+    if (!inPending) {
+        page.entries = addressIndex_.getHistory(address, afterHeight, afterPosition, limit + 1);
+    }
+    bool more = page.entries.size() > limit;
+    if (!more) {
+        size_t remaining = limit - page.entries.size();
+        auto pending = transactionPool_.getPendingHistory(address, afterSequence, remaining + 1);
+        page.entries.insert(page.entries.end(), pending.begin(), pending.end());
+        more = page.entries.size() > limit;
+    }
+    if (more) {
+        page.entries.resize(limit);
+        if (!page.entries.empty()) {
+            page.nextCursor = makeHistoryCursor(page.entries.back());
+        }
+    }
+    return page;
 }
 
 bool Blockchain::addTransactionToPool(const Transaction& transaction) {
@@ -77,32 +599,26 @@ bool Blockchain::addTransactionToPool(const Transaction& transaction) {
     return transactionPool_.addTransaction(transaction, utxoPool_);
 }
 
+std::vector<bool> Blockchain::addCheckedTransactionsToPool(const std::vector<Transaction>& transactions) {
+    return transactionPool_.addCheckedTransactions(transactions, utxoPool_);
+}
+
 std::vector<Transaction> Blockchain::getPendingTransactions() const {
     return transactionPool_.getTransactions();
 }
 
+void Blockchain::setTransactionPoolPolicy(const TransactionPoolPolicy& policy) {
+    transactionPool_.setPolicy(policy);
+}
+
+TransactionPoolStats Blockchain::getTransactionPoolStats() const {
+    return transactionPool_.getStats();
+}
+
 void Blockchain::updateUTXOPool(const Block& block) {
-    // 处理区块中的每个交易
+    // 整个区块的交易由UTXO池的写者一次性应用，读线程不需要等待其他分片
     std::cout << "\n  updateUTXOPool: " << block.getTransactions().size() << std::endl;
-    for (const auto& tx : block.getTransactions()) {
-        // 移除已使用的UTXO
-        std::cout << "    updateUTXOPool: " << tx.getTransactionId() << std::endl;
-        std::cout << "    inputs: " << tx.getInputs().size() << std::endl;
-        for (const auto& input : tx.getInputs()) {
-            utxoPool_.removeUTXO(input.getTxId(), input.getOutputIndex());
-            std::cout << "      removeUTXO: " << input.getTxId() << ", " << input.getOutputIndex() << std::endl;
-        }
-        
-        // 添加新的UTXO
-        std::cout << "    outputs: " << tx.getOutputs().size() << std::endl;
-        for (size_t i = 0; i < tx.getOutputs().size(); ++i) {
-            std::cout << "      addUTXO: " << tx.getTransactionId() << ", " << i << std::endl;
-            const auto& output = tx.getOutputs()[i];
-            UTXO utxo(tx.getTransactionId(), i, output.getAmount(), output.getOwner());
-            utxoPool_.addUTXO(utxo);
-            // std::cout << "      addUTXO: UTXO: " << utxo.getTxId() << ", " << utxo.getOutputIndex() << ", " << utxo.getAmount() << ", " << utxo.getOwner() << std::endl;
-        }
-    }
+    utxoPool_.applyTransactions(block.getTransactions());
 }
 
 void Blockchain::updateBalance(const std::string& address, double balance) {
@@ -129,17 +645,19 @@ double Blockchain::getBalance(const std::string& address) const {
 }
 
 bool Blockchain::isChainValid() const {
-    for (size_t i = 1; i < chain_.size(); ++i) {
-        const auto& currentBlock = chain_[i];
-        const auto& previousBlock = chain_[i - 1];
+    // 只需要区块头就能验证哈希和链接
+    auto snapshot = getSnapshot();
+    for (int i = 1; i < snapshot->getBlockCount(); ++i) {
+        const auto& currentHeader = snapshot->getHeader(i);
+        const auto& previousHeader = snapshot->getHeader(i - 1);
         
         // 验证当前区块的哈希
-        if (currentBlock->getHash() != currentBlock->calculateHash()) {
+        if (currentHeader.hash != currentHeader.calculateHash()) {
             return false;
         }
         
         // 验证区块链接
-        if (currentBlock->getPreviousHash() != previousBlock->getHash()) {
+        if (currentHeader.previousHash != previousHeader.hash) {
             return false;
         }
     }
@@ -183,19 +701,101 @@ std::vector<UTXO> Blockchain::getUTXOsForAddress(const std::string& address) con
     return utxoPool_.getUTXOsForAddress(address);
 }
 
-std::vector<Block> Blockchain::getBlocksFromHeight(int startHeight) const {
-    std::vector<Block> blocks;
-    for (size_t i = startHeight; i < chain_.size(); ++i) {
-        // 从智能指针获取 Block 对象
-        const Block& block = *chain_[i];
-        blocks.push_back(block);
+void Blockchain::forEachBlockChunk(int startHeight, size_t chunkSize,
+                                   const std::function<bool(const BlockChunk&)>& visitor) const {
+    // 开始时的链高度作为范围终点，遍历期间新接入的区块不在本次范围内
+    int endHeight = getBlockCount();
+    BlockChunk chunk;
+    chunk.reserve(chunkSize);
+    for (int height = std::max(startHeight, 0); height < endHeight; ++height) {
+        // 从缓存或存储获取共享的 Block 对象
+        auto block = getBlockByHeight(height);
+        if (!block) {
+            std::cout << "forEachBlockChunk: block " << height << " unavailable, stopping" << std::endl;
+            break;
+        }
+        chunk.push_back(block);
+        if (chunk.size() >= chunkSize) {
+            if (!visitor(chunk)) {
+                return;
+            }
+            chunk.clear();
+        }
+    }
+    if (!chunk.empty()) {
+        visitor(chunk);
+    }
+}
+
+std::vector<Transaction> Blockchain::refreshBlockTemplate(const Block& block) const {
+    std::unordered_set<std::string> included;
+    size_t usedBytes = 0;
+    for (const auto& tx : block.getTransactions()) {
+        included.insert(tx.getTransactionId());
+        usedBytes += tx.toJson().size();
+    }
+
+    // 区块里已有的交易不再是候选；它们的子交易的父交易已满足
+    std::vector<PoolEntry> candidates;
+    for (auto& entry : transactionPool_.getEntries()) {
+        if (included.count(entry.transaction.getTransactionId()) == 0) {
+            candidates.push_back(std::move(entry));
+        }
+    }
+    if (candidates.size() < templatePolicy_.minRefreshTransactions) {
+        return {};
+    }
+
+    // 只用剩余的空间和交易数组装追加部分
+    BlockTemplatePolicy remaining = templatePolicy_;
+    remaining.maxBlockBytes = templatePolicy_.maxBlockBytes > usedBytes ? templatePolicy_.maxBlockBytes - usedBytes : 0;
+    remaining.maxTransactions = templatePolicy_.maxTransactions > included.size()
+        ? templatePolicy_.maxTransactions - included.size() : 0;
+    BlockTemplate addition = BlockTemplateBuilder(remaining).build(candidates);
+    if (addition.transactions.size() < templatePolicy_.minRefreshTransactions) {
+        return {};
     }
-    return blocks;
+    // 手续费交易要留在区块最后：区块原有的手续费交易由 Block::appendTransactions 移除，
+    // 这里按区块原有交易加追加部分重新生成一笔放在末尾
+    std::vector<Transaction> paid;
+    for (const auto& tx : block.getTransactions()) {
+        if (!tx.isFeeTransaction()) {
+            paid.push_back(tx);
+        }
+    }
+    paid.insert(paid.end(), addition.transactions.begin(), addition.transactions.end());
+    appendFeeTransaction(paid, getMinerAddress(), block.getIndex());
+    if (!paid.empty() && paid.back().isFeeTransaction()) {
+        addition.transactions.push_back(paid.back());
+    }
+    return addition.transactions;
+}
+
+void Blockchain::setBlockTemplatePolicy(const BlockTemplatePolicy& policy) {
+    templatePolicy_ = policy;
+    std::cout << "Blockchain: block template limited to " << policy.maxBlockBytes << " bytes / "
+              << policy.maxTransactions << " transactions, ordered by "
+              << (policy.priority == BlockTemplatePolicy::Priority::FeeRate ? "fee rate" : "age") << std::endl;
+}
+
+void Blockchain::setMinerAddress(const std::string& address) {
+    std::lock_guard<std::mutex> lock(minerMutex_);
+    minerAddress_ = address;
+    std::cout << "Blockchain: block fees paid to " << (address.empty() ? "nobody" : address) << std::endl;
+}
+
+std::string Blockchain::getMinerAddress() const {
+    std::lock_guard<std::mutex> lock(minerMutex_);
+    return minerAddress_;
 }
 
-void Blockchain::clearPendingTransactions() {
-    std::cout << "clearPendingTransactions" << std::endl;
-    transactionPool_.clear();
+BlockTemplate Blockchain::createBlockTemplate() const {
+    auto entries = transactionPool_.getEntries();
+    BlockTemplate blockTemplate = BlockTemplateBuilder(templatePolicy_).build(entries);
+    std::cout << "createBlockTemplate: " << blockTemplate.transactions.size() << " of " << entries.size()
+              << " pending transactions, " << blockTemplate.transactionBytes << " bytes, fees "
+              << blockTemplate.totalFees << std::endl;
+    return blockTemplate;
 }
 
 void Blockchain::updateUTXO(const UTXO& utxo) {
@@ -214,16 +814,110 @@ std::vector<UTXO> Blockchain::getAllUTXOs() const {
     return allUtxos;
 }
 
+std::vector<UTXO> Blockchain::getUTXOSnapshot(std::shared_ptr<const ChainSnapshot>& snapshot) const {
+    // UTXO视图随快照一起发布，与快照链尾的承诺一致，不需要写者锁
+    snapshot = getSnapshot();
+    return snapshot->getUTXOs()->getAllUTXOs();
+}
+
+std::string Blockchain::getUTXOCommitment() const {
+    auto snapshot = getSnapshot();
+    return snapshot->getUTXOCommitment(snapshot->getBlockCount() - 1);
+}
+
+std::string Blockchain::getUTXOCommitmentAtHeight(int height) const {
+    auto snapshot = getSnapshot();
+    if (height < 0 || height >= snapshot->getBlockCount()) {
+        return "";
+    }
+    return snapshot->getUTXOCommitment(height);
+}
+
+bool Blockchain::replaceUTXOSet(const std::vector<UTXO>& utxos, int height) {
+    std::lock_guard<std::mutex> lock(chainMutex_);
+    auto snapshot = getSnapshot();
+    // UTXO池只对应链尾，其他高度的快照无法与本地状态对应
+    if (snapshot->empty() || height != snapshot->getBlockCount() - 1) {
+        std::cout << "replaceUTXOSet: snapshot at height " << height << " is not at the chain tip "
+                  << snapshot->getBlockCount() - 1 << std::endl;
+        return false;
+    }
+    if (!verifyUTXOSnapshot(utxos, snapshot->getUTXOCommitment(height))) {
+        return false;
+    }
+    std::lock_guard<std::mutex> balanceLock(balances_mutex_);
+    utxoPool_.replaceAll(utxos);
+    balances_.clear();
+    // 承诺相同说明集合相同，快照中已发布的UTXO视图不需要替换
+    std::cout << "replaceUTXOSet: replaced UTXO set with " << utxos.size() << " UTXOs at height " << height << std::endl;
+    return true;
+}
+
+bool Blockchain::verifyUTXOSnapshot(const std::vector<UTXO>& utxos, const std::string& commitment) const {
+    std::string computed = UTXOPool::computeCommitment(utxos);
+    if (computed != commitment) {
+        std::cout << "UTXO snapshot commitment mismatch: expected " << commitment
+                  << ", got " << computed << std::endl;
+        return false;
+    }
+    return true;
+}
+
 bool Blockchain::verifyBlock(const Block& block) const {
+    return checkBlockContext(block) && checkBlockContextFree(block);
+}
+
+bool Blockchain::checkBlockContextFree(const Block& block) const {
+    // 1. 验证区块哈希
+    if (block.getHash() != block.calculateHash()) {
+        std::cout << "Invalid block hash" << std::endl;
+        return false;
+    }
+    
+    // 2. 验证区块难度
+    if (!block.verifyDifficulty(difficulty_)) {
+        std::cout << "Block does not meet difficulty requirement" << std::endl;
+        return false;
+    }
+    
+    // 3. 验证交易签名（assume-valid 区块的祖先跳过）
+    if (isAssumedValid(block)) {
+        signaturesSkipped_ += block.getTransactions().size();
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& tx : block.getTransactions()) {
+            if (!tx.verifySignature()) {
+                std::cout << "Invalid transaction signature in block: " << tx.getTransactionId() << std::endl;
+                return false;
+            }
+        }
+        signatureVerifyNanos_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        signaturesVerified_ += block.getTransactions().size();
+    }
+    
+    // 4. 验证Merkle树根
+    std::vector<Transaction> transactions = block.getTransactions();
+    MerkleTree merkleTree(transactions);
+    if (block.getMerkleRoot() != merkleTree.getRootHash()) {
+        std::cout << "Invalid merkle root" << std::endl;
+        return false;
+    }
+    
+    return true;
+}
+
+bool Blockchain::checkBlockContext(const Block& block) const {
+    auto snapshot = getSnapshot();
     // 1. 验证区块索引
-    if (block.getIndex() != chain_.size()) {
+    if (block.getIndex() != snapshot->getBlockCount()) {
         std::cout << "Invalid block index" << std::endl;
         return false;
     }
     
     // 2. 验证前一个区块的哈希
-    if (!chain_.empty()) {
-        if (block.getPreviousHash() != chain_.back()->getHash()) {
+    if (!snapshot->empty()) {
+        if (block.getPreviousHash() != snapshot->getTip().hash) {
             std::cout << "Invalid previous hash" << std::endl;
             return false;
         }
@@ -232,35 +926,333 @@ bool Blockchain::verifyBlock(const Block& block) const {
         return false;
     }
     
-    // 3. 验证区块哈希
-    if (block.getHash() != block.calculateHash()) {
-        std::cout << "Invalid block hash" << std::endl;
-        return false;
+    // 3. 验证交易余额（系统交易不需要；有输入的交易由第4步按输入金额检查，
+    //    它花费的可能是同一区块中前面交易的输出，不在发送方的余额里）
+    for (const auto& tx : block.getTransactions()) {
+        if (tx.getFrom() == "SYSTEM" || !tx.getInputs().empty()) {
+            continue;
+        }
+        double balance = getBalance(tx.getFrom());
+        if (!tx.hasEnoughBalance(balance)) {
+            std::cout << "Insufficient balance for transaction in block: " << tx.getTransactionId() << std::endl;
+            return false;
+        }
     }
     
-    // 4. 验证区块难度
-    if (!block.verifyDifficulty(difficulty_)) {
-        std::cout << "Block does not meet difficulty requirement" << std::endl;
-        return false;
+    // 4. 输入/输出交易花费的输出必须存在、在区块内只被花费一次，且输入金额不少于输出金额加手续费
+    std::map<std::pair<std::string, int>, double> createdInBlock;
+    std::set<std::pair<std::string, int>> spentInBlock;
+    for (const auto& tx : block.getTransactions()) {
+        const auto& outputs = tx.getOutputs();
+        double outputTotal = 0.0;
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            outputTotal += outputs[i].getAmount();
+        }
+        if (tx.getFrom() != "SYSTEM" && (!tx.getInputs().empty() || !outputs.empty())) {
+            double inputTotal = 0.0;
+            for (const auto& input : tx.getInputs()) {
+                if (!spentInBlock.insert({input.getTxId(), input.getOutputIndex()}).second) {
+                    std::cout << "Input " << input.getTxId() << ":" << input.getOutputIndex()
+                              << " spent twice in block by: " << tx.getTransactionId() << std::endl;
+                    return false;
+                }
+                auto created = createdInBlock.find({input.getTxId(), input.getOutputIndex()});
+                UTXO spent;
+                if (created != createdInBlock.end()) {
+                    inputTotal += created->second;
+                } else if (utxoPool_.findUTXO(input.getTxId(), input.getOutputIndex(), spent)) {
+                    inputTotal += spent.getAmount();
+                } else {
+                    std::cout << "Missing input " << input.getTxId() << ":" << input.getOutputIndex()
+                              << " for transaction in block: " << tx.getTransactionId() << std::endl;
+                    return false;
+                }
+            }
+            if (inputTotal + Transaction::AMOUNT_EPSILON < outputTotal + tx.getFee()) {
+                std::cout << "Inputs " << inputTotal << " do not cover outputs " << outputTotal << " and fee "
+                          << tx.getFee() << " for transaction in block: " << tx.getTransactionId() << std::endl;
+                return false;
+            }
+        }
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            createdInBlock.emplace(std::make_pair(tx.getTransactionId(), static_cast<int>(i)), outputs[i].getAmount());
+        }
     }
     
-    // 5. 验证区块中的交易
-    for (const auto& tx : block.getTransactions()) {
-        if (!validateTransaction(tx)) {
-            std::cout << "Invalid transaction in block" << std::endl;
+    // 5. 有手续费的区块必须以唯一的一笔手续费交易结尾，金额等于全部手续费，输出等于输入/输出交易的手续费
+    const auto& transactions = block.getTransactions();
+    double fees;
+    double outputFees;
+    sumFees(transactions, fees, outputFees);
+    for (size_t i = 0; i + 1 < transactions.size(); ++i) {
+        if (transactions[i].isFeeTransaction()) {
+            std::cout << "Fee transaction is not the last transaction in block: " << transactions[i].getTransactionId() << std::endl;
             return false;
         }
     }
-    
-    // 6. 验证Merkle树根
-    std::vector<Transaction> transactions = block.getTransactions();
-    MerkleTree merkleTree(transactions);
-    if (block.getMerkleRoot() != merkleTree.getRootHash()) {
-        std::cout << "Invalid merkle root" << std::endl;
+    bool hasFeeTransaction = !transactions.empty() && transactions.back().isFeeTransaction();
+    if (fees <= 0.0) {
+        if (hasFeeTransaction) {
+            std::cout << "Fee transaction in a block without fees" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if (!hasFeeTransaction) {
+        std::cout << "Block with fees " << fees << " has no fee transaction" << std::endl;
+        return false;
+    }
+    const Transaction& feeTx = transactions.back();
+    const auto& feeInput = feeTx.getInputs()[0];
+    const auto& feeOutputs = feeTx.getOutputs();
+    bool outputsMatch = outputFees > 0.0
+        ? feeOutputs.size() == 1 && feeOutputs[0].getOwner() == feeTx.getTo() &&
+          std::abs(feeOutputs[0].getAmount() - outputFees) <= Transaction::AMOUNT_EPSILON
+        : feeOutputs.empty();
+    if (std::abs(feeTx.getAmount() - fees) > Transaction::AMOUNT_EPSILON || !outputsMatch ||
+        feeInput.getTxId() != Transaction::feeInputTxId(block.getIndex()) ||
+        feeInput.getOutputIndex() != static_cast<int>(transactions.size() - 1)) {
+        std::cout << "Fee transaction " << feeTx.getTransactionId() << " pays " << feeTx.getAmount()
+                  << ", block fees are " << fees << std::endl;
         return false;
     }
     
     return true;
 }
 
+bool Blockchain::acceptBlock(const Block& block) {
+    return acceptBlock(std::make_shared<Block>(block), false);
+}
+
+bool Blockchain::acceptBlock(const std::shared_ptr<Block>& blockPtr, bool contextFreeChecked) {
+    std::lock_guard<std::mutex> lock(chainMutex_);
+    const Block& block = *blockPtr;
+    if (getHeightByHash(block.getHash()) >= 0) {
+        std::cout << "acceptBlock: block already in chain: " << block.getHash() << std::endl;
+        return false;
+    }
+
+    // 父区块还没到：通过无上下文检查后放进孤块缓冲区，等父区块接入后自动接入
+    if (block.getIndex() > getBlockCount()) {
+        if (!contextFreeChecked && !checkBlockContextFree(block)) {
+            std::cout << "acceptBlock: orphan block verification failed: " << block.getHash() << std::endl;
+            return false;
+        }
+        orphanPool_.add(blockPtr);
+        return false;
+    }
+
+    bool valid = contextFreeChecked ? checkBlockContext(block) : verifyBlock(block);
+    if (!valid) {
+        std::cout << "acceptBlock: block verification failed: " << block.getHash() << std::endl;
+        return false;
+    }
+
+    connectAcceptedBlock(blockPtr);
+    connectOrphans();
+    return true;
+}
+
+void Blockchain::connectAcceptedBlock(const std::shared_ptr<Block>& block) {
+    // 区块不在已下载的区块头链上时，这条区块头链已经作废
+    if (!pendingHeaders_.empty()) {
+        if (pendingHeaders_.front().hash == block->getHash()) {
+            pendingHeaders_.pop_front();
+        } else {
+            std::cout << "acceptBlock: block is not on the header chain, dropping "
+                      << pendingHeaders_.size() << " pending headers" << std::endl;
+            pendingHeaders_.clear();
+        }
+    }
+
+    connectBlock(block);
+}
+
+void Blockchain::connectOrphans() {
+    orphanPool_.prune(getBlockCount());
+    // 孤块加入缓冲区时已经做过无上下文检查，这里只需要按顺序做上下文检查
+    while (true) {
+        bool connected = false;
+        for (const auto& child : orphanPool_.takeChildren(getLastHeader().hash)) {
+            if (!connected && checkBlockContext(*child)) {
+                std::cout << "acceptBlock: connecting buffered block " << child->getIndex() << std::endl;
+                connectAcceptedBlock(child);
+                connected = true;
+            }
+        }
+        if (!connected) {
+            break;
+        }
+    }
+}
+
+bool Blockchain::isOrphan(const std::string& hash) const {
+    return orphanPool_.contains(hash);
+}
+
+int Blockchain::getHeightByHash(const std::string& hash) const {
+    int height;
+    {
+        std::shared_lock<std::shared_mutex> lock(heightByHashMutex_);
+        auto it = heightByHash_.find(hash);
+        if (it == heightByHash_.end()) {
+            return -1;
+        }
+        height = it->second;
+    }
+    // 正在接入、尚未发布的区块对读者不可见
+    return height < getBlockCount() ? height : -1;
+}
+
+std::vector<BlockHeader> Blockchain::getHeadersAfter(const std::vector<std::string>& locator, size_t maxHeaders) const {
+    int startHeight = 0;
+    for (const auto& hash : locator) {
+        int height = getHeightByHash(hash);
+        if (height >= 0) {
+            startHeight = height + 1;
+            break;
+        }
+    }
+
+    auto snapshot = getSnapshot();
+    std::vector<BlockHeader> result;
+    for (int height = startHeight; height < snapshot->getBlockCount() && result.size() < maxHeaders; ++height) {
+        result.push_back(snapshot->getHeader(height));
+    }
+    return result;
+}
+
+bool Blockchain::acceptHeaders(const std::vector<BlockHeader>& headers) {
+    std::lock_guard<std::mutex> lock(chainMutex_);
+    // 跳过已经在链上的区块头
+    size_t first = 0;
+    while (first < headers.size() && getHeightByHash(headers[first].hash) >= 0) {
+        first++;
+    }
+    if (first == headers.size()) {
+        return true;
+    }
+
+    // 找到这批区块头的父节点：待下载队列的末尾或链尾
+    auto snapshot = getSnapshot();
+    const BlockHeader* parent = nullptr;
+    bool replacePending = false;
+    const std::string& previousHash = headers[first].previousHash;
+    if (!pendingHeaders_.empty() && previousHash == pendingHeaders_.back().hash) {
+        parent = &pendingHeaders_.back();
+    } else if (previousHash == snapshot->getTip().hash) {
+        parent = &snapshot->getTip();
+        replacePending = !pendingHeaders_.empty();
+    } else {
+        std::cout << "acceptHeaders: headers do not connect to our chain" << std::endl;
+        return false;
+    }
+
+    // 只检查区块头本身：高度连续、前一哈希链接、哈希正确、满足难度
+    int expectedIndex = parent->index + 1;
+    std::string expectedPrevious = parent->hash;
+    for (size_t i = first; i < headers.size(); ++i) {
+        const BlockHeader& header = headers[i];
+        if (header.index != expectedIndex || header.previousHash != expectedPrevious) {
+            std::cout << "acceptHeaders: broken linkage at height " << header.index << std::endl;
+            return false;
+        }
+        if (header.hash != header.calculateHash()) {
+            std::cout << "acceptHeaders: invalid hash at height " << header.index << std::endl;
+            return false;
+        }
+        if (!header.verifyDifficulty(difficulty_)) {
+            std::cout << "acceptHeaders: insufficient proof of work at height " << header.index << std::endl;
+            return false;
+        }
+        expectedIndex++;
+        expectedPrevious = header.hash;
+    }
+
+    if (replacePending) {
+        std::cout << "acceptHeaders: replacing " << pendingHeaders_.size() << " pending headers" << std::endl;
+        pendingHeaders_.clear();
+    }
+    pendingHeaders_.insert(pendingHeaders_.end(), headers.begin() + first, headers.end());
+    updateAssumeValidChain();
+    std::cout << "acceptHeaders: " << headers.size() - first << " headers accepted, best header height "
+              << pendingHeaders_.back().index << std::endl;
+    return true;
+}
+
+std::vector<std::string> Blockchain::getMissingBlockHashes(size_t maxCount) const {
+    std::lock_guard<std::mutex> lock(chainMutex_);
+    std::vector<std::string> hashes;
+    for (size_t i = 0; i < pendingHeaders_.size() && hashes.size() < maxCount; ++i) {
+        // 已经提前到达、在孤块缓冲区里等待的区块不必再下载
+        if (!orphanPool_.contains(pendingHeaders_[i].hash)) {
+            hashes.push_back(pendingHeaders_[i].hash);
+        }
+    }
+    return hashes;
+}
 
+BlockHeader Blockchain::getBestHeader() const {
+    std::lock_guard<std::mutex> lock(chainMutex_);
+    return pendingHeaders_.empty() ? getLastHeader() : pendingHeaders_.back();
+}
+
+void Blockchain::setAssumeValid(const std::string& hash) {
+    {
+        std::lock_guard<std::mutex> lock(assumeValidMutex_);
+        assumeValidHash_ = hash;
+        assumeValidChain_.clear();
+    }
+    std::cout << "Blockchain: assume-valid block " << (hash.empty() ? "disabled" : hash) << std::endl;
+    std::lock_guard<std::mutex> lock(chainMutex_);
+    updateAssumeValidChain();
+}
+
+std::string Blockchain::getAssumeValid() const {
+    std::lock_guard<std::mutex> lock(assumeValidMutex_);
+    return assumeValidHash_;
+}
+
+void Blockchain::updateAssumeValidChain() {
+    std::lock_guard<std::mutex> lock(assumeValidMutex_);
+    // 哈希链接唯一确定了祖先集合，建立一次之后不会再变
+    if (assumeValidHash_.empty() || !assumeValidChain_.empty()) {
+        return;
+    }
+    // 已经接入链的 assume-valid 区块没有需要跳过的后续检查
+    size_t pendingCount = 0;
+    while (pendingCount < pendingHeaders_.size() && pendingHeaders_[pendingCount].hash != assumeValidHash_) {
+        pendingCount++;
+    }
+    if (pendingCount == pendingHeaders_.size()) {
+        return;
+    }
+
+    auto snapshot = getSnapshot();
+    std::vector<std::string> chain;
+    chain.reserve(snapshot->getBlockCount() + pendingCount + 1);
+    for (int height = 0; height < snapshot->getBlockCount(); ++height) {
+        chain.push_back(snapshot->getHeader(height).hash);
+    }
+    for (size_t i = 0; i <= pendingCount; ++i) {
+        chain.push_back(pendingHeaders_[i].hash);
+    }
+    assumeValidChain_ = std::move(chain);
+    std::cout << "Blockchain: assume-valid block found at height " << assumeValidChain_.size() - 1
+              << ", skipping signature checks up to it" << std::endl;
+}
+
+bool Blockchain::isAssumedValid(const Block& block) const {
+    std::lock_guard<std::mutex> lock(assumeValidMutex_);
+    size_t height = static_cast<size_t>(block.getIndex());
+    return height < assumeValidChain_.size() && assumeValidChain_[height] == block.getHash();
+}
+
+Blockchain::SignatureCheckStats Blockchain::getSignatureCheckStats() const {
+    SignatureCheckStats stats;
+    stats.verified = signaturesVerified_;
+    stats.skipped = signaturesSkipped_;
+    stats.verifyMs = signatureVerifyNanos_ / 1e6;
+    stats.estimatedSavedMs = stats.verified == 0 ? 0.0 : stats.verifyMs / stats.verified * stats.skipped;
+    return stats;
+}
@@ -4,25 +4,82 @@
 #include "wallet.h"
 #include "utxo.h"
 #include "transactionpool.h"
+#include "blockstore.h"
+#include "blockcache.h"
+#include "orphanpool.h"
+#include "txindex.h"
+#include "addressindex.h"
+#include "balancehistory.h"
+#include "chainsnapshot.h"
+#include "blocktemplate.h"
 #include <vector>
+#include <deque>
 #include <memory>
 #include "transaction.h"
 #include <map>
+#include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <functional>
 
 class Blockchain {
 public:
-    Blockchain(int difficulty);
+    // dataDir 为空时只在内存中保存链；否则从区块存储恢复并持续追加
+    Blockchain(int difficulty, const std::string& dataDir = "");
+    ~Blockchain();
     
+    // usePendingTxs 为 true 时忽略 transactions，按区块模板策略从交易池选取交易
     void addBlock(const std::vector<Transaction>& transactions, bool usePendingTxs);
+    // 区块模板：限制区块的字节数和交易数，按手续费率或进入交易池的先后选取交易
+    void setBlockTemplatePolicy(const BlockTemplatePolicy& policy);
+    BlockTemplate createBlockTemplate() const;
+    // 本节点出块时手续费的收款地址；为空时手续费交易付给 SYSTEM，即销毁
+    void setMinerAddress(const std::string& address);
+    std::string getMinerAddress() const;
     bool isChainValid() const;
-    const std::vector<std::shared_ptr<Block>>& getChain() const { return chain_; }
-    std::shared_ptr<Block>& getLastBlock() { return chain_.back(); }
+    // 链上只常驻区块头，区块体按需从存储加载并经过LRU缓存。
+    // 当前链状态的不可变快照：读者拿到后不加锁读取，接入区块时发布新版本，读写互不阻塞。
+    // 需要同时读取多项链状态（高度、链尾、承诺）时应使用同一个快照以保证一致
+    std::shared_ptr<const ChainSnapshot> getSnapshot() const;
+    BlockHeader getLastHeader() const { return getSnapshot()->getTip(); }
+    int getBlockCount() const { return getSnapshot()->getBlockCount(); }
+    std::shared_ptr<Block> getLastBlock() const { return getBlockByHeight(getBlockCount() - 1); }
+    // 设置区块体缓存的字节预算（只在有区块存储时生效）
+    void setBlockCacheBudget(size_t maxBytes);
+    // 修剪模式：区块存储超过 diskBudgetBytes 时删除比链尾早 keepDepth 个区块以前的区块体，
+    // 保留区块头和UTXO集合（写入 chainstate.json）。与交易索引不兼容
+    bool enablePruning(uint64_t diskBudgetBytes, int keepDepth = DEFAULT_PRUNE_KEEP_DEPTH);
+    // 低于该高度的区块体已不可用（未修剪时为 0）
+    int getPruneHeight() const;
+    static const int DEFAULT_PRUNE_KEEP_DEPTH = 288;
+    // 按哈希/高度查找区块，O(1)且不复制链
+    std::shared_ptr<Block> getBlockByHash(const std::string& hash) const;
+    std::shared_ptr<Block> getBlockByHeight(int height) const;
     int getDifficulty() const { return difficulty_; }
     bool validateTransaction(const Transaction& tx) const;
     double getBalance(const std::string& address) const;
-    // 获取从指定高度开始的所有区块
-    std::vector<Block> getBlocksFromHeight(int startHeight) const;
+    // address 在高度 height 的区块接入之后的余额（按区块余额变更累计，O(log n)）
+    double getBalanceAtHeight(const std::string& address, int height) const;
+    // 从 startHeight 开始按高度分块遍历区块，每块最多 chunkSize 个共享的只读区块，
+    // visitor 返回 false 时停止。同一时刻只有当前这一块驻留内存，不复制区块
+    using BlockChunk = std::vector<std::shared_ptr<const Block>>;
+    void forEachBlockChunk(int startHeight, size_t chunkSize,
+                           const std::function<bool(const BlockChunk&)>& visitor) const;
+    
+    // 可选的交易索引：txid -> (高度, 下标, 字节偏移)，有区块存储时保存在存储目录的 txindex.dat
+    bool enableTxIndex();
+    bool hasTxIndex() const { return txIndex_ != nullptr; }
+    bool getTransaction(const std::string& txId, Transaction& tx, TxLocation* location = nullptr) const;
+    // 已确认交易的Merkle证明（从叶子到根）及所在区块的Merkle根
+    bool getTransactionProof(const std::string& txId, std::vector<std::pair<std::string, bool>>& proof,
+                             std::string& merkleRoot) const;
+    
+    // 地址历史：先按 (高度, 下标) 返回已确认交易，再按进入交易池的顺序返回待处理交易。
+    // cursor 为上一页返回的 nextCursor，空字符串表示从头开始
+    AddressHistoryPage getAddressHistory(const std::string& address, const std::string& cursor = "",
+                                         size_t limit = DEFAULT_HISTORY_PAGE_SIZE) const;
+    static const size_t DEFAULT_HISTORY_PAGE_SIZE = 50;
     
     // 添加钱包管理功能
     void registerWallet(std::shared_ptr<Wallet> wallet);
@@ -30,7 +87,12 @@ public:
     
     // 新增的UTXO和交易池相关方法
     bool addTransactionToPool(const Transaction& transaction);
+    // 批量添加已通过 TransactionPool::checkTransaction 的交易，返回值与 transactions 一一对应
+    std::vector<bool> addCheckedTransactionsToPool(const std::vector<Transaction>& transactions);
     std::vector<Transaction> getPendingTransactions() const;
+    // 交易池的内存上限、淘汰策略与统计
+    void setTransactionPoolPolicy(const TransactionPoolPolicy& policy);
+    TransactionPoolStats getTransactionPoolStats() const;
     void updateUTXOPool(const Block& block);
     std::vector<UTXO> getUTXOsForAddress(const std::string& address) const;
     
@@ -39,13 +101,72 @@ public:
     void updateUTXOs(const std::string& address, const std::vector<UTXO>& utxos);
     std::vector<UTXO> getAllUTXOs() const;
     
+    // UTXO集合承诺：当前UTXO池的完整快照及其在各高度的MuHash承诺。
+    // UTXO集合取自 snapshot 中发布的视图，正好对应 snapshot 链尾的承诺
+    std::vector<UTXO> getUTXOSnapshot(std::shared_ptr<const ChainSnapshot>& snapshot) const;
+    std::string getUTXOCommitment() const;
+    std::string getUTXOCommitmentAtHeight(int height) const;
+    bool verifyUTXOSnapshot(const std::vector<UTXO>& utxos, const std::string& commitment) const;
+    // 用对端发来的UTXO快照替换UTXO池。只接受链尾高度 height 的快照，
+    // 并且只信任本节点在该高度自己记录的承诺，不信任对端声明的承诺
+    bool replaceUTXOSet(const std::vector<UTXO>& utxos, int height);
+    
     // 添加区块验证方法
     bool verifyBlock(const Block& block) const;
+    // 与链状态无关的检查（哈希、工作量证明、签名、Merkle根），可以在多个线程中并行执行
+    bool checkBlockContextFree(const Block& block) const;
+    // 依赖链尾状态的检查（高度、前一区块哈希、余额），必须按顺序执行
+    bool checkBlockContext(const Block& block) const;
+    // 接收一个完整区块（来自同步或其他节点），验证通过后接到链尾
+    bool acceptBlock(const Block& block);
+    // contextFreeChecked 为 true 时调用方已经完成了无上下文检查，只做按序的上下文检查。
+    // 父区块尚未到达的区块放进孤块缓冲区（返回 false），父区块接入后自动接入
+    bool acceptBlock(const std::shared_ptr<Block>& block, bool contextFreeChecked);
+    bool isOrphan(const std::string& hash) const;
+    
+    // 区块头优先同步
+    int getHeightByHash(const std::string& hash) const;
+    // 从 locator 中第一个已知的哈希之后开始，返回最多 maxHeaders 个区块头
+    std::vector<BlockHeader> getHeadersAfter(const std::vector<std::string>& locator, size_t maxHeaders) const;
+    // 验证一批区块头（链接、哈希、工作量证明），通过后加入待下载队列
+    bool acceptHeaders(const std::vector<BlockHeader>& headers);
+    // 已有区块头、尚未下载区块体的区块哈希（按高度顺序）
+    std::vector<std::string> getMissingBlockHashes(size_t maxCount) const;
+    // 最佳区块头链的末端（没有待下载区块头时就是链尾）
+    BlockHeader getBestHeader() const;
+    
+    // 假定有效（assume-valid）：该区块及其在区块头链上的祖先跳过签名检查，
+    // 结构、工作量证明、Merkle根和UTXO检查照常进行。空字符串表示关闭
+    void setAssumeValid(const std::string& hash);
+    std::string getAssumeValid() const;
+    struct SignatureCheckStats {
+        size_t verified;          // 实际验证的签名数
+        size_t skipped;           // 因 assume-valid 跳过的签名数
+        double verifyMs;          // 验证签名花费的总时间
+        double estimatedSavedMs;  // 按平均验证时间估算节省的时间（没有样本时为 0）
+    };
+    SignatureCheckStats getSignatureCheckStats() const;
     // 添加余额管理方法
     void updateBalance(const std::string& address, double balance);
     
 private:
-    std::vector<std::shared_ptr<Block>> chain_;
+    // 已发布的链状态（高度 -> 区块头、UTXO承诺），只通过 std::atomic_load/atomic_store 访问
+    std::shared_ptr<const ChainSnapshot> snapshot_ = std::make_shared<ChainSnapshot>();
+    // 串行化修改链的操作（接入区块、接受区块头、开启索引/修剪），读者不需要它
+    mutable std::mutex chainMutex_;
+    mutable BlockCache blockCache_;                      // 高度 -> 区块体（LRU）
+    std::map<int, std::shared_ptr<Block>> unpersistedBlocks_;  // 写入存储失败的区块体，常驻内存
+    mutable std::mutex unpersistedMutex_;
+    std::unordered_map<std::string, int> heightByHash_;  // 区块哈希 -> 高度
+    mutable std::shared_mutex heightByHashMutex_;
+    std::deque<BlockHeader> pendingHeaders_;             // 已验证、等待区块体的区块头，紧接在链尾之后
+    OrphanPool orphanPool_;                              // 父区块尚未接入的区块
+    std::string assumeValidHash_;
+    std::vector<std::string> assumeValidChain_;          // 高度 -> assume-valid 区块及其祖先的哈希（区块头已知后才建立）
+    mutable std::mutex assumeValidMutex_;                // 并行验证线程会读取 assumeValidChain_
+    mutable std::atomic<size_t> signaturesVerified_{0};
+    mutable std::atomic<size_t> signaturesSkipped_{0};
+    mutable std::atomic<long long> signatureVerifyNanos_{0};
     int difficulty_;
     std::map<std::string, double> balanceCache_;  // 余额缓存
     std::map<std::string, std::shared_ptr<Wallet>> wallets_;  // 钱包映射
@@ -53,11 +174,42 @@ private:
     // UTXO池和交易池
     UTXOPool utxoPool_;
     TransactionPool transactionPool_;
+    BlockTemplatePolicy templatePolicy_;
+    std::string minerAddress_;
+    mutable std::mutex minerMutex_;
     
     std::map<std::string, std::vector<UTXO>> utxos_;  // 添加UTXO存储
     
+    std::unique_ptr<BlockStore> blockStore_;          // 区块持久化存储（可选）
+    std::unique_ptr<TxIndex> txIndex_;                // 交易索引（可选）
+    uint64_t pruneBudget_ = 0;                        // 区块存储的字节预算，0 表示不修剪
+    int pruneKeepDepth_ = DEFAULT_PRUNE_KEEP_DEPTH;
+    AddressIndex addressIndex_;                       // 地址 -> 已确认交易
+    BalanceHistory balanceHistory_;                   // 地址 -> 各高度的累计余额
+    
     std::shared_ptr<Block> createGenesisBlock();
-    void clearPendingTransactions();
+    // 把区块接到链尾，并维护索引、UTXO池和承诺，最后发布新的链快照；
+    // persist 为 false 时不写存储（用于启动恢复）。调用者须持有 chainMutex_（构造期间除外）
+    void connectBlock(const std::shared_ptr<Block>& block, bool persist = true);
+    // 计算区块的余额变更：输出记入所有者，输入从被花费UTXO的所有者扣除；
+    // 没有输入输出的旧式交易按 from/to 记账（SYSTEM 不扣除）
+    std::map<std::string, double> computeBalanceChanges(const Block& block) const;
+    // 维护待下载区块头队列后接入一个已验证的区块
+    void connectAcceptedBlock(const std::shared_ptr<Block>& block);
+    // 接入所有以链尾为父区块的孤块（递归地）
+    void connectOrphans();
+    // assume-valid 区块出现在区块头链上后，记录它和它的全部祖先
+    void updateAssumeValidChain();
+    bool isAssumedValid(const Block& block) const;
+    // 从区块存储恢复链，只验证上次正常关闭之后新增的区块
+    bool loadFromStore();
+    // 修剪后无法从区块体重建的状态：全部区块头、UTXO承诺和当前UTXO集合
+    std::string chainStatePath() const;
+    bool writeChainState() const;
+    bool loadChainState(int blockCount);
+    void pruneBlockStore();
+    // 挖矿中的模板刷新：从交易池中选出不在区块里、且能放进剩余空间的交易
+    std::vector<Transaction> refreshBlockTemplate(const Block& block) const;
     
     mutable std::map<std::string, double> balances_;  // 添加 mutable 关键字
     mutable std::mutex balances_mutex_;               // 互斥锁也需要是 mutable
@@ -0,0 +1,478 @@
+#include "blockstore.h"
+#include "compression.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+static const uint32_t RECORD_MAGIC = 0xB10C5701;
+static const uint32_t COMPRESSED_RECORD_MAGIC = 0xB10C5702;   // 数据为 Compression::compress 的结果
+static const size_t RECORD_HEADER_SIZE = 12;   // magic + size + crc
+static const size_t HASH_FIELD_SIZE = 64;
+static const size_t INDEX_ENTRY_SIZE = 4 + HASH_FIELD_SIZE + 4 + 8 + 4 + 4 + 4;
+
+// 小端序读写辅助函数
+static void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static void putU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static uint32_t getU32(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return value;
+}
+
+static uint64_t getU64(const char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return value;
+}
+
+static uint32_t crc32(const std::string& data) {
+    // 标准 CRC-32（多项式 0xEDB88320），表在第一次调用时生成
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (unsigned char byte : data) {
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// 把索引项编码为定长记录，最后4字节是前面内容的 CRC32
+static std::string encodeIndexEntry(const BlockLocation& location) {
+    std::string entry;
+    putU32(entry, static_cast<uint32_t>(location.height));
+    std::string hash = location.hash;
+    hash.resize(HASH_FIELD_SIZE, '\0');
+    entry += hash;
+    putU32(entry, location.fileNumber);
+    putU64(entry, location.offset);
+    putU32(entry, location.size);
+    putU32(entry, location.checksum);
+    putU32(entry, crc32(entry));
+    return entry;
+}
+
+BlockStore::BlockStore(const std::string& directory, uint64_t maxSegmentSize)
+    : directory_(directory)
+    , maxSegmentSize_(maxSegmentSize)
+    , totalBytes_(0)
+    , pruneHeight_(0)
+{
+}
+
+std::string BlockStore::segmentPath(uint32_t fileNumber) const {
+    std::stringstream ss;
+    ss << "blk" << std::setw(5) << std::setfill('0') << fileNumber << ".dat";
+    return (fs::path(directory_) / ss.str()).string();
+}
+
+std::string BlockStore::indexPath() const {
+    return (fs::path(directory_) / "index.dat").string();
+}
+
+std::string BlockStore::cleanMarkerPath() const {
+    return (fs::path(directory_) / "clean").string();
+}
+
+std::string BlockStore::pruneMarkerPath() const {
+    return (fs::path(directory_) / "pruned").string();
+}
+
+bool BlockStore::open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    if (ec) {
+        std::cout << "BlockStore::open: cannot create " << directory_ << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    index_.clear();
+    totalBytes_ = 0;
+    pruneHeight_ = 0;
+    std::ifstream pruneMarker(pruneMarkerPath());
+    if (!(pruneMarker >> pruneHeight_)) {
+        pruneHeight_ = 0;
+    }
+
+    std::ifstream in(indexPath(), std::ios::binary);
+    std::string raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    // 逐项读取索引，遇到校验失败或数据不完整的项就停止
+    for (size_t pos = 0; pos + INDEX_ENTRY_SIZE <= raw.size(); pos += INDEX_ENTRY_SIZE) {
+        std::string entry = raw.substr(pos, INDEX_ENTRY_SIZE);
+        const char* p = entry.data();
+        if (getU32(p + INDEX_ENTRY_SIZE - 4) != crc32(entry.substr(0, INDEX_ENTRY_SIZE - 4))) {
+            std::cout << "BlockStore::open: corrupt index entry at " << index_.size() << std::endl;
+            break;
+        }
+
+        BlockLocation location;
+        location.height = static_cast<int>(getU32(p));
+        location.hash = std::string(p + 4, HASH_FIELD_SIZE);
+        location.hash.resize(location.hash.find('\0') == std::string::npos ? HASH_FIELD_SIZE : location.hash.find('\0'));
+        location.fileNumber = getU32(p + 4 + HASH_FIELD_SIZE);
+        location.offset = getU64(p + 8 + HASH_FIELD_SIZE);
+        location.size = getU32(p + 16 + HASH_FIELD_SIZE);
+        location.checksum = getU32(p + 20 + HASH_FIELD_SIZE);
+
+        if (location.height != static_cast<int>(index_.size())) {
+            std::cout << "BlockStore::open: unexpected height " << location.height << std::endl;
+            break;
+        }
+        // 已修剪的区块只保留索引项
+        if (location.height < pruneHeight_) {
+            index_.push_back(location);
+            continue;
+        }
+        uint64_t fileSize = fs::file_size(segmentPath(location.fileNumber), ec);
+        if (ec || location.offset + RECORD_HEADER_SIZE + location.size > fileSize) {
+            std::cout << "BlockStore::open: block " << location.height << " is incomplete" << std::endl;
+            break;
+        }
+
+        index_.push_back(location);
+        totalBytes_ += RECORD_HEADER_SIZE + location.size;
+    }
+
+    // 丢弃未完成的尾部：多余的索引项和段文件中未被索引的数据
+    if (raw.size() != index_.size() * INDEX_ENTRY_SIZE) {
+        rewriteIndex();
+    }
+    if (!index_.empty()) {
+        const BlockLocation& last = index_.back();
+        uint64_t end = last.offset + RECORD_HEADER_SIZE + last.size;
+        if (fs::file_size(segmentPath(last.fileNumber), ec) > end) {
+            fs::resize_file(segmentPath(last.fileNumber), end, ec);
+        }
+    }
+
+    std::cout << "BlockStore::open: " << directory_ << " has " << index_.size() << " blocks";
+    if (pruneHeight_ > 0) {
+        std::cout << " (pruned below " << pruneHeight_ << ")";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+bool BlockStore::writeBlock(const Block& block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (block.getIndex() != static_cast<int>(index_.size())) {
+        std::cout << "BlockStore::writeBlock: out of order block " << block.getIndex() << std::endl;
+        return false;
+    }
+
+    std::string data = block.toJson();
+    uint32_t magic = RECORD_MAGIC;
+    // 只有压缩后更小才存压缩格式，两种记录可以混在同一个段文件里
+    if (compression_) {
+        std::string packed = Compression::compress(data);
+        if (packed.size() < data.size()) {
+            data = std::move(packed);
+            magic = COMPRESSED_RECORD_MAGIC;
+        }
+    }
+
+    // 当前段写满后切换到下一个段文件
+    std::error_code ec;
+    uint32_t fileNumber = index_.empty() ? 0 : index_.back().fileNumber;
+    uint64_t fileSize = fs::exists(segmentPath(fileNumber)) ? fs::file_size(segmentPath(fileNumber), ec) : 0;
+    if (fileSize > 0 && fileSize + RECORD_HEADER_SIZE + data.size() > maxSegmentSize_) {
+        fileNumber++;
+        fileSize = fs::exists(segmentPath(fileNumber)) ? fs::file_size(segmentPath(fileNumber), ec) : 0;
+    }
+
+    BlockLocation location;
+    location.height = block.getIndex();
+    location.hash = block.getHash();
+    location.fileNumber = fileNumber;
+    location.offset = fileSize;
+    location.size = static_cast<uint32_t>(data.size());
+    location.checksum = crc32(data);
+
+    std::string record;
+    putU32(record, magic);
+    putU32(record, location.size);
+    putU32(record, location.checksum);
+    record += data;
+
+    // 先写区块数据，再写索引项；崩溃时最多丢失一个未被索引的区块
+    std::ofstream segment(segmentPath(fileNumber), std::ios::binary | std::ios::app);
+    segment.write(record.data(), record.size());
+    segment.flush();
+    if (!segment) {
+        std::cout << "BlockStore::writeBlock: failed to write " << segmentPath(fileNumber) << std::endl;
+        return false;
+    }
+
+    std::ofstream indexFile(indexPath(), std::ios::binary | std::ios::app);
+    std::string entry = encodeIndexEntry(location);
+    indexFile.write(entry.data(), entry.size());
+    indexFile.flush();
+    if (!indexFile) {
+        std::cout << "BlockStore::writeBlock: failed to write index" << std::endl;
+        return false;
+    }
+
+    index_.push_back(location);
+    totalBytes_ += record.size();
+    return true;
+}
+
+bool BlockStore::readRecord(const BlockLocation& location, std::string& data) const {
+    std::ifstream segment(segmentPath(location.fileNumber), std::ios::binary);
+    if (!segment) {
+        return false;
+    }
+    segment.seekg(static_cast<std::streamoff>(location.offset));
+
+    char header[RECORD_HEADER_SIZE];
+    if (!segment.read(header, RECORD_HEADER_SIZE)) {
+        return false;
+    }
+    uint32_t magic = getU32(header);
+    if ((magic != RECORD_MAGIC && magic != COMPRESSED_RECORD_MAGIC) || getU32(header + 4) != location.size) {
+        return false;
+    }
+
+    data.resize(location.size);
+    if (!segment.read(&data[0], location.size)) {
+        return false;
+    }
+    // 校验和针对磁盘上的字节，先校验再解压
+    if (crc32(data) != location.checksum || getU32(header + 8) != location.checksum) {
+        return false;
+    }
+    if (magic == COMPRESSED_RECORD_MAGIC) {
+        std::string raw;
+        if (!Compression::decompress(data, raw)) {
+            std::cout << "BlockStore::readRecord: cannot decompress block " << location.height << std::endl;
+            return false;
+        }
+        data = std::move(raw);
+    }
+    return true;
+}
+
+std::shared_ptr<Block> BlockStore::readBlock(int height) const {
+    BlockLocation location;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (height < pruneHeight_ || height >= static_cast<int>(index_.size())) {
+            return nullptr;
+        }
+        location = index_[height];
+    }
+
+    std::string data;
+    if (!readRecord(location, data)) {
+        std::cout << "BlockStore::readBlock: checksum mismatch at height " << height << std::endl;
+        return nullptr;
+    }
+
+    auto block = std::make_shared<Block>(json::parse(data));
+    if (block->getHash() != location.hash) {
+        std::cout << "BlockStore::readBlock: hash mismatch at height " << height << std::endl;
+        return nullptr;
+    }
+    return block;
+}
+
+bool BlockStore::readRange(int height, uint64_t offset, uint32_t size, std::string& data) const {
+    BlockLocation location;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (height < pruneHeight_ || height >= static_cast<int>(index_.size())) {
+            return false;
+        }
+        location = index_[height];
+    }
+
+    std::ifstream segment(segmentPath(location.fileNumber), std::ios::binary);
+    if (!segment) {
+        return false;
+    }
+    segment.seekg(static_cast<std::streamoff>(location.offset));
+    char header[RECORD_HEADER_SIZE];
+    if (!segment.read(header, RECORD_HEADER_SIZE)) {
+        return false;
+    }
+
+    // 偏移是相对于未压缩的区块JSON的，压缩记录只能整条解压后再截取
+    if (getU32(header) == COMPRESSED_RECORD_MAGIC) {
+        segment.close();
+        std::string block;
+        if (!readRecord(location, block) || offset + size > block.size()) {
+            return false;
+        }
+        data = block.substr(offset, size);
+        return true;
+    }
+
+    if (offset + size > location.size) {
+        return false;
+    }
+    segment.seekg(static_cast<std::streamoff>(location.offset + RECORD_HEADER_SIZE + offset));
+    data.resize(size);
+    return static_cast<bool>(segment.read(&data[0], size));
+}
+
+void BlockStore::truncate(int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (height < 0 || height >= static_cast<int>(index_.size())) {
+        return;
+    }
+    std::cout << "BlockStore::truncate: dropping blocks from height " << height << std::endl;
+
+    std::error_code ec;
+    uint32_t lastFile = index_.back().fileNumber;
+    index_.resize(height);
+    rewriteIndex();
+
+    // 截断最后一个保留段文件，删除之后的段文件
+    uint32_t keepFile = 0;
+    uint64_t keepEnd = 0;
+    if (!index_.empty()) {
+        keepFile = index_.back().fileNumber;
+        keepEnd = index_.back().offset + RECORD_HEADER_SIZE + index_.back().size;
+    }
+    fs::resize_file(segmentPath(keepFile), keepEnd, ec);
+    for (uint32_t file = keepFile + 1; file <= lastFile; ++file) {
+        fs::remove(segmentPath(file), ec);
+    }
+
+    totalBytes_ = 0;
+    for (size_t i = static_cast<size_t>(std::max(pruneHeight_, 0)); i < index_.size(); ++i) {
+        totalBytes_ += RECORD_HEADER_SIZE + index_[i].size;
+    }
+}
+
+int BlockStore::getPrunableHeight(int maxHeight, uint64_t targetBytes) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index_.empty()) {
+        return pruneHeight_;
+    }
+
+    // 从最旧的段开始整段累计；正在追加的最后一个段文件永远保留
+    uint32_t lastFile = index_.back().fileNumber;
+    uint64_t remaining = totalBytes_;
+    int height = pruneHeight_;
+    while (height < static_cast<int>(index_.size()) && remaining > targetBytes) {
+        uint32_t file = index_[height].fileNumber;
+        if (file == lastFile) {
+            break;
+        }
+        int end = height;
+        uint64_t bytes = 0;
+        while (end < static_cast<int>(index_.size()) && index_[end].fileNumber == file) {
+            bytes += RECORD_HEADER_SIZE + index_[end].size;
+            end++;
+        }
+        if (end > maxHeight) {
+            break;
+        }
+        remaining -= bytes;
+        height = end;
+    }
+    return height;
+}
+
+uint64_t BlockStore::pruneBelow(int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (height <= pruneHeight_ || height > static_cast<int>(index_.size())) {
+        return 0;
+    }
+    // 只能在段文件边界修剪
+    if (height < static_cast<int>(index_.size()) &&
+        index_[height].fileNumber == index_[height - 1].fileNumber) {
+        std::cout << "BlockStore::pruneBelow: height " << height << " is not a segment boundary" << std::endl;
+        return 0;
+    }
+
+    // 先记录修剪高度再删除文件，崩溃后不会把缺失的段当作损坏
+    {
+        std::ofstream marker(pruneMarkerPath(), std::ios::trunc);
+        marker << height;
+    }
+    std::error_code ec;
+    uint64_t freed = 0;
+    uint32_t files = 0;
+    for (int h = pruneHeight_; h < height; ++h) {
+        freed += RECORD_HEADER_SIZE + index_[h].size;
+        if (h + 1 == height || index_[h + 1].fileNumber != index_[h].fileNumber) {
+            fs::remove(segmentPath(index_[h].fileNumber), ec);
+            files++;
+        }
+    }
+    pruneHeight_ = height;
+    totalBytes_ -= freed;
+    std::cout << "BlockStore::pruneBelow: removed " << files << " segment files (" << freed
+              << " bytes), block bodies below height " << pruneHeight_ << " are gone" << std::endl;
+    return freed;
+}
+
+int BlockStore::getPruneHeight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pruneHeight_;
+}
+
+void BlockStore::rewriteIndex() {
+    std::string raw;
+    for (const auto& location : index_) {
+        raw += encodeIndexEntry(location);
+    }
+    std::ofstream indexFile(indexPath(), std::ios::binary | std::ios::trunc);
+    indexFile.write(raw.data(), raw.size());
+}
+
+int BlockStore::getBlockCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(index_.size());
+}
+
+BlockLocation BlockStore::getLocation(int height) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.at(height);
+}
+
+uint64_t BlockStore::getTotalBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalBytes_;
+}
+
+int BlockStore::getValidatedHeight() const {
+    std::ifstream marker(cleanMarkerPath());
+    int height = -1;
+    if (!(marker >> height)) {
+        return -1;
+    }
+    return height;
+}
+
+void BlockStore::setValidatedHeight(int height) {
+    std::ofstream marker(cleanMarkerPath(), std::ios::trunc);
+    marker << height;
+}
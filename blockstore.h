@@ -0,0 +1,79 @@
+#pragma once
+
+#include "block.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+// 区块在存储中的位置
+struct BlockLocation {
+    int height;
+    std::string hash;
+    uint32_t fileNumber;   // 段文件编号 blkNNNNN.dat
+    uint64_t offset;       // 记录在段文件中的起始偏移
+    uint32_t size;         // 记录数据长度（不含记录头，压缩记录为压缩后的长度）
+    uint32_t checksum;     // 记录数据的 CRC32
+};
+
+// 只追加的区块文件存储
+// 区块按高度顺序写入分段文件，每条记录为 [magic][size][crc32][区块JSON]，
+// 压缩后更小的区块以另一个 magic 存为 LZ4 压缩数据（见 Compression）；
+// index.dat 保存 高度/哈希/位置 的定长索引项，每项自带校验和，
+// 启动时丢弃写了一半的尾部记录。clean 文件记录上次正常关闭时已验证的高度，
+// pruned 文件记录区块体已被修剪到的高度（修剪以整个段文件为单位）。
+class BlockStore {
+public:
+    BlockStore(const std::string& directory, uint64_t maxSegmentSize = DEFAULT_SEGMENT_SIZE);
+
+    // 打开存储并加载索引，截断崩溃时残留的不完整记录
+    bool open();
+
+    // 追加一个区块，高度必须等于当前存储的区块数
+    bool writeBlock(const Block& block);
+    // 读取指定高度的区块，校验和不匹配时返回 nullptr
+    std::shared_ptr<Block> readBlock(int height) const;
+    // 只读取区块JSON中的一段（例如其中一笔交易），不校验整条记录的校验和；
+    // 压缩记录需要整条读取解压（此时会校验）
+    bool readRange(int height, uint64_t offset, uint32_t size, std::string& data) const;
+    // 丢弃指定高度及之后的所有区块
+    void truncate(int height);
+    // 修剪以整个段文件为单位：返回从最旧的段开始、只删除全部区块都低于 maxHeight 的段，
+    // 使总字节数不超过 targetBytes 时能修剪到的高度（无可修剪时等于 getPruneHeight）
+    int getPrunableHeight(int maxHeight, uint64_t targetBytes) const;
+    // 删除 height 以下的区块体（height 必须是段边界），索引项保留，返回释放的字节数
+    uint64_t pruneBelow(int height);
+    // 低于该高度的区块体已被修剪
+    int getPruneHeight() const;
+
+    // 是否压缩新写入的区块（默认开启），不影响已写入的记录
+    void setCompression(bool enabled) { compression_ = enabled; }
+
+    int getBlockCount() const;
+    BlockLocation getLocation(int height) const;
+    uint64_t getTotalBytes() const;
+    const std::string& getDirectory() const { return directory_; }
+
+    // 正常关闭标记：记录已经验证过的最高高度，-1 表示没有
+    int getValidatedHeight() const;
+    void setValidatedHeight(int height);
+
+    static const uint64_t DEFAULT_SEGMENT_SIZE = 16 * 1024 * 1024;
+
+private:
+    std::string directory_;
+    uint64_t maxSegmentSize_;
+    std::vector<BlockLocation> index_;
+    uint64_t totalBytes_;      // 仍在磁盘上的区块记录字节数
+    int pruneHeight_;
+    bool compression_ = true;
+    mutable std::mutex mutex_;
+
+    std::string segmentPath(uint32_t fileNumber) const;
+    std::string indexPath() const;
+    std::string cleanMarkerPath() const;
+    std::string pruneMarkerPath() const;
+    bool readRecord(const BlockLocation& location, std::string& data) const;
+    void rewriteIndex();
+};
@@ -0,0 +1,72 @@
+#include "blocktemplate.h"
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+BlockTemplateBuilder::BlockTemplateBuilder(const BlockTemplatePolicy& policy)
+    : policy_(policy)
+{
+}
+
+BlockTemplate BlockTemplateBuilder::build(const std::vector<PoolEntry>& entries) const {
+    BlockTemplate result;
+
+    // 建立池内依赖：父交易 -> 子交易，以及每笔交易尚未选中的父交易数
+    std::unordered_map<std::string, size_t> indexById;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        indexById[entries[i].transaction.getTransactionId()] = i;
+    }
+    std::vector<std::vector<size_t>> children(entries.size());
+    std::vector<size_t> missingParents(entries.size(), 0);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        std::unordered_set<size_t> parents;
+        for (const auto& input : entries[i].transaction.getInputs()) {
+            auto parent = indexById.find(input.getTxId());
+            if (parent != indexById.end() && parent->second != i) {
+                parents.insert(parent->second);
+            }
+        }
+        for (size_t parent : parents) {
+            children[parent].push_back(i);
+        }
+        missingParents[i] = parents.size();
+    }
+
+    // 优先队列的比较函数：返回 true 表示 a 排在 b 之后
+    bool byFeeRate = policy_.priority == BlockTemplatePolicy::Priority::FeeRate;
+    auto lowerPriority = [&entries, byFeeRate](size_t a, size_t b) {
+        const PoolEntry& x = entries[a];
+        const PoolEntry& y = entries[b];
+        if (byFeeRate && x.getFeeRate() != y.getFeeRate()) {
+            return x.getFeeRate() < y.getFeeRate();
+        }
+        return x.sequence > y.sequence;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(lowerPriority)> ready(lowerPriority);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (missingParents[i] == 0) {
+            ready.push(i);
+        }
+    }
+
+    size_t budget = policy_.maxBlockBytes > BLOCK_OVERHEAD_BYTES ? policy_.maxBlockBytes - BLOCK_OVERHEAD_BYTES : 0;
+    while (!ready.empty() && result.transactions.size() < policy_.maxTransactions) {
+        size_t i = ready.top();
+        ready.pop();
+        // 放不下的交易跳过，继续尝试更小的交易；它的子交易也不会被选中
+        if (result.transactionBytes + entries[i].size > budget) {
+            continue;
+        }
+        result.transactions.push_back(entries[i].transaction);
+        result.transactionBytes += entries[i].size;
+        result.totalFees += entries[i].transaction.getFee();
+        for (size_t child : children[i]) {
+            if (--missingParents[child] == 0) {
+                ready.push(child);
+            }
+        }
+    }
+
+    result.deferred = entries.size() - result.transactions.size();
+    return result;
+}
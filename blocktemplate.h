@@ -0,0 +1,50 @@
+#pragma once
+
+#include "transactionpool.h"
+#include <vector>
+#include <cstddef>
+
+// 区块模板的组装策略
+struct BlockTemplatePolicy {
+    enum class Priority {
+        FeeRate,   // 每字节手续费高的优先，相同时先到先打包
+        Age        // 先进入交易池的优先
+    };
+
+    size_t maxBlockBytes = DEFAULT_MAX_BLOCK_BYTES;     // 区块序列化后的最大字节数（含区块头开销）
+    size_t maxTransactions = DEFAULT_MAX_TRANSACTIONS;
+    Priority priority = Priority::FeeRate;
+    // 挖矿期间每隔 refreshIntervalMs 检查交易池，至少有 minRefreshTransactions 笔新交易
+    // 能放进区块时才追加并重新开始搜索 nonce；refreshIntervalMs 为 0 表示不刷新
+    unsigned refreshIntervalMs = DEFAULT_REFRESH_INTERVAL_MS;
+    size_t minRefreshTransactions = DEFAULT_MIN_REFRESH_TRANSACTIONS;
+
+    static const size_t DEFAULT_MAX_BLOCK_BYTES = 1024 * 1024;
+    static const size_t DEFAULT_MAX_TRANSACTIONS = 4000;
+    static const unsigned DEFAULT_REFRESH_INTERVAL_MS = 500;
+    static const size_t DEFAULT_MIN_REFRESH_TRANSACTIONS = 4;
+};
+
+struct BlockTemplate {
+    std::vector<Transaction> transactions;  // 父交易总在依赖它的子交易之前
+    size_t transactionBytes = 0;            // 已选交易序列化后的字节数
+    double totalFees = 0.0;
+    size_t deferred = 0;                    // 放不下或依赖的父交易未被选中而留在交易池的交易数
+};
+
+// 从交易池条目中选出一个区块的交易：按优先级依次加入，直到达到字节数或交易数上限。
+// 交易的输入引用了池中另一笔交易时，只有父交易已被选中，子交易才会参与排序
+class BlockTemplateBuilder {
+public:
+    explicit BlockTemplateBuilder(const BlockTemplatePolicy& policy = BlockTemplatePolicy());
+
+    BlockTemplate build(const std::vector<PoolEntry>& entries) const;
+
+    const BlockTemplatePolicy& getPolicy() const { return policy_; }
+
+    // 为区块头、时间戳等非交易字段预留的字节数
+    static const size_t BLOCK_OVERHEAD_BYTES = 512;
+
+private:
+    BlockTemplatePolicy policy_;
+};
@@ -0,0 +1,102 @@
+#include "blockvalidator.h"
+#include <iostream>
+#include <chrono>
+#include <deque>
+#include <future>
+
+// 并行阶段的输出
+struct PreparedBlock {
+    std::shared_ptr<Block> block;  // 反序列化失败时为空
+    bool valid = false;
+};
+
+BlockValidator::BlockValidator(Blockchain& blockchain, ThreadPool& pool)
+    : blockchain_(blockchain)
+    , pool_(pool)
+{
+}
+
+BlockValidationResult BlockValidator::process(const json& blocks) {
+    BlockValidationResult result;
+    result.received = blocks.size();
+    if (blocks.empty()) {
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const Blockchain& chain = blockchain_;
+
+    std::deque<std::future<PreparedBlock>> inFlight;
+    size_t next = 0;
+    auto submitNext = [&]() {
+        const json& blockData = blocks[next++];
+        inFlight.push_back(pool_.submit([&chain, &blockData]() {
+            PreparedBlock prepared;
+            try {
+                prepared.block = std::make_shared<Block>(blockData);
+            } catch (const std::exception& e) {
+                std::cout << "BlockValidator: failed to parse block: " << e.what() << std::endl;
+                return prepared;
+            }
+            prepared.valid = chain.checkBlockContextFree(*prepared.block);
+            return prepared;
+        }));
+    };
+
+    while (next < blocks.size() && inFlight.size() < windowSize()) {
+        submitNext();
+    }
+
+    bool stopped = false;
+    while (!inFlight.empty()) {
+        PreparedBlock prepared = inFlight.front().get();
+        inFlight.pop_front();
+        if (stopped) {
+            // 已经失败，只需等待剩余任务结束（它们引用了 blocks）
+            continue;
+        }
+        if (next < blocks.size()) {
+            submitNext();
+        }
+
+        if (!prepared.block) {
+            ++result.rejected;
+            stopped = true;
+            continue;
+        }
+        // 已在链上的区块（例如对端从创世区块开始发送）直接跳过
+        if (blockchain_.getHeightByHash(prepared.block->getHash()) >= 0) {
+            ++result.known;
+            continue;
+        }
+        if (!prepared.valid) {
+            ++result.rejected;
+            stopped = true;
+            continue;
+        }
+        // 后面的区块都依赖这一个，失败后停止；父区块还没到的区块被缓冲，继续处理
+        if (!blockchain_.acceptBlock(prepared.block, true)) {
+            if (blockchain_.isOrphan(prepared.block->getHash())) {
+                ++result.buffered;
+                continue;
+            }
+            ++result.rejected;
+            stopped = true;
+            continue;
+        }
+        ++result.connected;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "BlockValidator: " << result.connected << "/" << result.received
+              << " blocks connected (" << result.known << " known, " << result.buffered << " buffered, " << result.rejected
+              << " rejected) in " << elapsed << " ms using " << pool_.size() << " threads" << std::endl;
+    Blockchain::SignatureCheckStats stats = blockchain_.getSignatureCheckStats();
+    if (stats.skipped > 0) {
+        std::cout << "BlockValidator: assume-valid skipped " << stats.skipped << " signature checks (verified "
+                  << stats.verified << " in " << stats.verifyMs << " ms), estimated saving "
+                  << stats.estimatedSavedMs << " ms" << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "blockchain.h"
+#include "threadpool.h"
+#include <nlohmann/json.hpp>
+#include <cstddef>
+
+using json = nlohmann::json;
+
+// 一批区块的处理结果
+struct BlockValidationResult {
+    size_t received = 0;   // 收到的区块数
+    size_t connected = 0;  // 成功接到链尾的区块数
+    size_t known = 0;      // 已在链上、直接跳过的区块数
+    size_t buffered = 0;   // 父区块未到、放入孤块缓冲区的区块数
+    size_t rejected = 0;   // 验证失败的区块数（失败后其后的区块不再处理）
+};
+
+// 同步追赶时的分阶段区块验证流水线：
+//   阶段1（并行）：反序列化、哈希、工作量证明、签名和Merkle根检查
+//   阶段2（串行）：按高度顺序做上下文检查并应用到UTXO
+// 串行阶段处理第 i 个区块时，线程池已经在验证后面的区块
+class BlockValidator {
+public:
+    BlockValidator(Blockchain& blockchain, ThreadPool& pool);
+
+    // blocks 是按高度排列的区块 JSON 数组
+    BlockValidationResult process(const json& blocks);
+
+private:
+    Blockchain& blockchain_;
+    ThreadPool& pool_;
+
+    // 并行阶段最多领先串行阶段多少个区块，限制同时驻留内存的区块数
+    size_t windowSize() const { return pool_.size() * 4; }
+};
@@ -0,0 +1,140 @@
+#include "chainsnapshot.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+UTXOSetView::UTXOSetView() {
+    static const auto emptyBucket = std::make_shared<const Bucket>();
+    buckets_.assign(BUCKET_COUNT, emptyBucket);
+}
+
+size_t UTXOSetView::bucketIndex(const std::string& txId) {
+    return std::hash<std::string>{}(txId) % BUCKET_COUNT;
+}
+
+std::shared_ptr<const UTXOSetView> UTXOSetView::apply(const std::shared_ptr<const UTXOSetView>& previous,
+                                                      const std::vector<Transaction>& transactions) {
+    auto next = std::make_shared<UTXOSetView>();
+    if (previous) {
+        next->buckets_ = previous->buckets_;
+        next->size_ = previous->size_;
+    }
+
+    // 分桶可能还被旧版本的读者持有，每个被触及的分桶只复制一次
+    std::vector<std::shared_ptr<Bucket>> copied(BUCKET_COUNT);
+    auto writable = [&](const std::string& txId) -> Bucket& {
+        size_t index = bucketIndex(txId);
+        if (!copied[index]) {
+            copied[index] = std::make_shared<Bucket>(*next->buckets_[index]);
+            next->buckets_[index] = copied[index];
+        }
+        return *copied[index];
+    };
+
+    for (const auto& tx : transactions) {
+        for (const auto& input : tx.getInputs()) {
+            next->size_ -= writable(input.getTxId()).erase({input.getTxId(), input.getOutputIndex()});
+        }
+        const std::string& txId = tx.getTransactionId();
+        for (size_t i = 0; i < tx.getOutputs().size(); ++i) {
+            const auto& output = tx.getOutputs()[i];
+            auto result = writable(txId).insert_or_assign({txId, static_cast<int>(i)},
+                                                          UTXO(txId, i, output.getAmount(), output.getOwner()));
+            if (result.second) {
+                next->size_++;
+            }
+        }
+    }
+    return next;
+}
+
+std::shared_ptr<const UTXOSetView> UTXOSetView::build(const std::vector<UTXO>& utxos) {
+    std::vector<std::shared_ptr<Bucket>> buckets(BUCKET_COUNT);
+    for (auto& bucket : buckets) {
+        bucket = std::make_shared<Bucket>();
+    }
+    for (const auto& utxo : utxos) {
+        (*buckets[bucketIndex(utxo.getTxId())])[{utxo.getTxId(), utxo.getOutputIndex()}] = utxo;
+    }
+    auto view = std::make_shared<UTXOSetView>();
+    view->size_ = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        view->size_ += buckets[i]->size();
+        view->buckets_[i] = buckets[i];
+    }
+    return view;
+}
+
+std::vector<UTXO> UTXOSetView::getAllUTXOs() const {
+    std::vector<UTXO> utxos;
+    utxos.reserve(size_);
+    for (const auto& bucket : buckets_) {
+        for (const auto& [outpoint, utxo] : *bucket) {
+            utxos.push_back(utxo);
+        }
+    }
+    return utxos;
+}
+
+std::shared_ptr<const ChainSnapshot> ChainSnapshot::append(const std::shared_ptr<const ChainSnapshot>& previous,
+                                                           const BlockHeader& header,
+                                                           const std::string& utxoCommitment,
+                                                           std::shared_ptr<const UTXOSetView> utxos) {
+    auto next = std::make_shared<ChainSnapshot>();
+    next->utxos_ = std::move(utxos);
+    if (previous) {
+        // 只复制分块指针，分块本身共享
+        next->chunks_ = previous->chunks_;
+        next->count_ = previous->count_;
+    }
+
+    if (next->count_ % CHUNK_SIZE == 0) {
+        auto chunk = std::make_shared<Chunk>();
+        chunk->reserve(CHUNK_SIZE);
+        chunk->push_back({header, utxoCommitment});
+        next->chunks_.push_back(chunk);
+    } else {
+        // 最后一个分块可能还被旧版本的读者持有，复制后再追加
+        auto chunk = std::make_shared<Chunk>(*next->chunks_.back());
+        chunk->push_back({header, utxoCommitment});
+        next->chunks_.back() = chunk;
+    }
+    next->count_++;
+    return next;
+}
+
+std::shared_ptr<const ChainSnapshot> ChainSnapshot::build(const std::vector<BlockHeader>& headers,
+                                                          const std::vector<std::string>& utxoCommitments,
+                                                          std::shared_ptr<const UTXOSetView> utxos) {
+    if (headers.size() != utxoCommitments.size()) {
+        throw std::invalid_argument("ChainSnapshot::build: headers and commitments differ in length");
+    }
+    auto snapshot = std::make_shared<ChainSnapshot>();
+    snapshot->utxos_ = std::move(utxos);
+    for (size_t start = 0; start < headers.size(); start += CHUNK_SIZE) {
+        auto chunk = std::make_shared<Chunk>();
+        size_t end = std::min(start + CHUNK_SIZE, headers.size());
+        chunk->reserve(CHUNK_SIZE);
+        for (size_t i = start; i < end; ++i) {
+            chunk->push_back({headers[i], utxoCommitments[i]});
+        }
+        snapshot->chunks_.push_back(chunk);
+    }
+    snapshot->count_ = headers.size();
+    return snapshot;
+}
+
+const BlockHeader& ChainSnapshot::getHeader(int height) const {
+    return entry(height).header;
+}
+
+const std::string& ChainSnapshot::getUTXOCommitment(int height) const {
+    return entry(height).utxoCommitment;
+}
+
+const ChainSnapshot::Entry& ChainSnapshot::entry(int height) const {
+    if (height < 0 || height >= getBlockCount()) {
+        throw std::out_of_range("ChainSnapshot: height " + std::to_string(height) + " out of range");
+    }
+    return (*chunks_[height / CHUNK_SIZE])[height % CHUNK_SIZE];
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "block.h"
+#include "utxo.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 某一版本的UTXO集合的不可变视图，随 ChainSnapshot 一起发布。
+// UTXO按交易ID散列到固定数量的分桶，应用区块时只复制被交易触及的分桶，
+// 其余分桶在各版本之间共享
+class UTXOSetView {
+public:
+    UTXOSetView();
+
+    // 在 previous（为空表示空集合）上按顺序应用区块的交易，规则与 UTXOPool::applyTransactions 相同
+    static std::shared_ptr<const UTXOSetView> apply(const std::shared_ptr<const UTXOSetView>& previous,
+                                                    const std::vector<Transaction>& transactions);
+    // 一次性从完整的UTXO列表构建（启动恢复、导入快照时使用）
+    static std::shared_ptr<const UTXOSetView> build(const std::vector<UTXO>& utxos);
+
+    std::vector<UTXO> getAllUTXOs() const;
+    size_t size() const { return size_; }
+
+    static const size_t BUCKET_COUNT = 256;
+
+private:
+    using Bucket = std::map<std::pair<std::string, int>, UTXO>;  // (txId, outputIndex) -> UTXO
+
+    std::vector<std::shared_ptr<const Bucket>> buckets_;
+    size_t size_ = 0;
+
+    static size_t bucketIndex(const std::string& txId);
+};
+
+// 某一时刻链状态的不可变快照：各高度的区块头、该区块应用后的UTXO集合承诺，以及链尾的UTXO集合。
+// 读者通过 Blockchain::getSnapshot 拿到快照后不需要任何锁，接入新区块也不会改变它；
+// 写者用 append 生成新版本后原子地发布。条目按定长分块保存，已写满的分块在
+// 各版本之间共享，生成新版本只需要复制最后一个未满的分块
+class ChainSnapshot {
+public:
+    // 在 previous（为空表示空链）之后追加一个区块，返回新版本
+    // utxos 是应用该区块后的UTXO集合，与 utxoCommitment 对应
+    static std::shared_ptr<const ChainSnapshot> append(const std::shared_ptr<const ChainSnapshot>& previous,
+                                                       const BlockHeader& header, const std::string& utxoCommitment,
+                                                       std::shared_ptr<const UTXOSetView> utxos);
+    // 一次性从完整的区块头和承诺列表构建（启动恢复时使用），两者长度必须相同
+    static std::shared_ptr<const ChainSnapshot> build(const std::vector<BlockHeader>& headers,
+                                                      const std::vector<std::string>& utxoCommitments,
+                                                      std::shared_ptr<const UTXOSetView> utxos);
+
+    int getBlockCount() const { return static_cast<int>(count_); }
+    bool empty() const { return count_ == 0; }
+    const BlockHeader& getHeader(int height) const;
+    const BlockHeader& getTip() const { return getHeader(getBlockCount() - 1); }
+    const std::string& getUTXOCommitment(int height) const;
+    // 链尾的UTXO集合，与 getUTXOCommitment(getBlockCount() - 1) 一致
+    const std::shared_ptr<const UTXOSetView>& getUTXOs() const { return utxos_; }
+
+    static const size_t CHUNK_SIZE = 256;
+
+private:
+    struct Entry {
+        BlockHeader header;
+        std::string utxoCommitment;
+    };
+    using Chunk = std::vector<Entry>;
+
+    std::vector<std::shared_ptr<const Chunk>> chunks_;
+    size_t count_ = 0;
+    std::shared_ptr<const UTXOSetView> utxos_ = std::make_shared<UTXOSetView>();
+
+    const Entry& entry(int height) const;
+};
@@ -0,0 +1,132 @@
+#include "coinselector.h"
+#include <iostream>
+#include <limits>
+
+CoinSelector::CoinSelector(size_t maxInputs, double changeTolerance)
+    : maxInputs_(maxInputs)
+    , changeTolerance_(changeTolerance)
+{
+}
+
+CoinSelectionResult CoinSelector::select(const CoinSet& candidates, double target, CoinSelectionStrategy strategy) const {
+    switch (strategy) {
+        case CoinSelectionStrategy::BranchAndBound:
+            return branchAndBound(candidates, target);
+        case CoinSelectionStrategy::LargestFirst:
+            return largestFirst(candidates, target);
+        case CoinSelectionStrategy::SmallestFirst:
+            return smallestFirst(candidates, target);
+    }
+    return CoinSelectionResult();
+}
+
+CoinSelectionResult CoinSelector::select(const CoinSet& candidates, double target) const {
+    CoinSelectionResult result = branchAndBound(candidates, target);
+    if (result.success) {
+        std::cout << "CoinSelector: exact match with " << result.selected.size() << " inputs" << std::endl;
+        return result;
+    }
+    return largestFirst(candidates, target);
+}
+
+CoinSelectionResult CoinSelector::branchAndBound(const CoinSet& candidates, double target) const {
+    CoinSelectionResult result;
+    const double epsilon = 1e-12;
+
+    // 转成可随机访问的数组，remaining[i] 为第 i 个之后（含）所有金额之和
+    std::vector<const CoinCandidate*> coins;
+    coins.reserve(candidates.size());
+    for (const auto& candidate : candidates) {
+        coins.push_back(&candidate);
+    }
+    std::vector<double> remaining(coins.size() + 1, 0.0);
+    for (size_t i = coins.size(); i > 0; --i) {
+        remaining[i - 1] = remaining[i] + coins[i - 1]->amount;
+    }
+    if (remaining[0] + epsilon < target) {
+        return result;
+    }
+
+    // 深度优先：每个币依次尝试“选入”和“不选”两个分支
+    std::vector<size_t> current;
+    std::vector<size_t> best;
+    double currentValue = 0.0;
+    double bestExcess = std::numeric_limits<double>::max();
+    size_t index = 0;
+
+    for (size_t tries = 0; tries < BNB_MAX_TRIES; ++tries) {
+        bool backtrack = false;
+        if (currentValue + remaining[index] + epsilon < target) {
+            backtrack = true;  // 剩下的全选也不够
+        } else if (currentValue > target + changeTolerance_ + epsilon) {
+            backtrack = true;  // 超出容差，会产生找零
+        } else if (currentValue + epsilon >= target) {
+            double excess = currentValue - target;
+            if (excess < bestExcess) {
+                bestExcess = excess;
+                best = current;
+            }
+            if (excess <= epsilon) {
+                break;  // 精确匹配，不可能更好
+            }
+            backtrack = true;
+        } else if (current.size() >= maxInputs_ || index >= coins.size()) {
+            backtrack = true;
+        }
+
+        if (backtrack) {
+            if (current.empty()) {
+                break;  // 搜索空间已穷尽
+            }
+            // 撤销最后一次选入，转到“不选”分支，并跳过金额相同的兄弟节点
+            size_t last = current.back();
+            current.pop_back();
+            currentValue -= coins[last]->amount;
+            index = last + 1;
+            while (index < coins.size() && coins[index]->amount == coins[last]->amount) {
+                ++index;
+            }
+            continue;
+        }
+
+        current.push_back(index);
+        currentValue += coins[index]->amount;
+        ++index;
+    }
+
+    if (best.empty()) {
+        return result;
+    }
+    result.success = true;
+    for (size_t i : best) {
+        result.selected.push_back(*coins[i]);
+        result.total += coins[i]->amount;
+    }
+    return result;
+}
+
+CoinSelectionResult CoinSelector::largestFirst(const CoinSet& candidates, double target) const {
+    CoinSelectionResult result;
+    for (auto it = candidates.begin(); it != candidates.end() && result.total < target; ++it) {
+        if (result.selected.size() >= maxInputs_) {
+            break;
+        }
+        result.selected.push_back(*it);
+        result.total += it->amount;
+    }
+    result.success = result.total >= target;
+    return result;
+}
+
+CoinSelectionResult CoinSelector::smallestFirst(const CoinSet& candidates, double target) const {
+    CoinSelectionResult result;
+    for (auto it = candidates.rbegin(); it != candidates.rend() && result.total < target; ++it) {
+        if (result.selected.size() >= maxInputs_) {
+            break;
+        }
+        result.selected.push_back(*it);
+        result.total += it->amount;
+    }
+    result.success = result.total >= target;
+    return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <cstddef>
+
+// 候选UTXO：选币只需要金额和位置，不需要复制整个UTXO
+struct CoinCandidate {
+    double amount;
+    std::string txId;
+    int outputIndex;
+
+    // 按金额从大到小排序，金额相同时按位置排序保证唯一
+    bool operator<(const CoinCandidate& other) const {
+        if (amount != other.amount) return amount > other.amount;
+        if (txId != other.txId) return txId < other.txId;
+        return outputIndex < other.outputIndex;
+    }
+};
+
+// 每个地址的UTXO按金额排好序的集合
+using CoinSet = std::set<CoinCandidate>;
+
+// 选币策略
+enum class CoinSelectionStrategy {
+    BranchAndBound,  // 分支定界：寻找总额恰好落在 [目标, 目标 + 容差] 内的组合，不产生找零
+    LargestFirst,    // 从大到小：输入数最少
+    SmallestFirst    // 从小到大：优先消耗零碎的UTXO
+};
+
+struct CoinSelectionResult {
+    bool success = false;
+    std::vector<CoinCandidate> selected;
+    double total = 0.0;
+};
+
+class CoinSelector {
+public:
+    CoinSelector(size_t maxInputs = DEFAULT_MAX_INPUTS, double changeTolerance = DEFAULT_CHANGE_TOLERANCE);
+
+    // 使用指定策略选币，candidates 必须来自按金额排序的 CoinSet
+    CoinSelectionResult select(const CoinSet& candidates, double target, CoinSelectionStrategy strategy) const;
+    // 默认选币：先尝试精确匹配，失败时退回从大到小
+    CoinSelectionResult select(const CoinSet& candidates, double target) const;
+
+    size_t getMaxInputs() const { return maxInputs_; }
+
+    static const size_t DEFAULT_MAX_INPUTS = 50;
+    static constexpr double DEFAULT_CHANGE_TOLERANCE = 1e-8;
+    // 分支定界最多尝试的节点数，防止大钱包上的指数搜索
+    static const size_t BNB_MAX_TRIES = 100000;
+
+private:
+    size_t maxInputs_;
+    double changeTolerance_;
+
+    CoinSelectionResult branchAndBound(const CoinSet& candidates, double target) const;
+    CoinSelectionResult largestFirst(const CoinSet& candidates, double target) const;
+    CoinSelectionResult smallestFirst(const CoinSet& candidates, double target) const;
+};
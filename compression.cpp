@@ -0,0 +1,249 @@
+#include "compression.h"
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// LZ4 块格式的常量：最短匹配4字节，最后5字节必须是字面量，
+// 最后一个匹配至少在结尾前12字节开始
+static const size_t MIN_MATCH = 4;
+static const size_t LAST_LITERALS = 5;
+static const size_t MF_LIMIT = 12;
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 12;
+
+static uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// 写入长度的扩展字节：每个 255 表示"还有更多"
+static void putLength(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+static void emitSequence(std::string& out, const unsigned char* literals, size_t literalLength,
+                         size_t offset, size_t matchLength) {
+    size_t tokenPos = out.size();
+    out.push_back(0);
+    unsigned char token = 0;
+
+    if (literalLength >= 15) {
+        token = 15 << 4;
+        putLength(out, literalLength - 15);
+    } else {
+        token = static_cast<unsigned char>(literalLength << 4);
+    }
+    out.append(reinterpret_cast<const char*>(literals), literalLength);
+
+    // matchLength 为 0 表示最后一段只有字面量
+    if (matchLength > 0) {
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>((offset >> 8) & 0xFF));
+        size_t extra = matchLength - MIN_MATCH;
+        if (extra >= 15) {
+            token |= 15;
+            putLength(out, extra - 15);
+        } else {
+            token |= static_cast<unsigned char>(extra);
+        }
+    }
+    out[tokenPos] = static_cast<char>(token);
+}
+
+std::string Compression::compress(const std::string& data) {
+    std::string out;
+    uint32_t rawSize = static_cast<uint32_t>(data.size());
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((rawSize >> (8 * i)) & 0xFF));
+    out.reserve(4 + data.size() / 2 + 16);
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t size = data.size();
+    size_t anchor = 0;
+
+    if (size > MF_LIMIT) {
+        // 哈希表记录每个4字节序列最近一次出现的位置（+1，0 表示空）
+        std::vector<uint32_t> table(1u << HASH_BITS, 0);
+        const size_t matchLimit = size - LAST_LITERALS;
+        size_t pos = 0;
+        while (pos + MF_LIMIT < size) {
+            uint32_t sequence = read32(src + pos);
+            uint32_t h = hashSequence(sequence);
+            size_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(pos + 1);
+
+            if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != sequence) {
+                pos++;
+                continue;
+            }
+            size_t ref = candidate - 1;
+            size_t matchLength = MIN_MATCH;
+            while (pos + matchLength < matchLimit && src[ref + matchLength] == src[pos + matchLength]) {
+                matchLength++;
+            }
+            emitSequence(out, src + anchor, pos - anchor, pos - ref, matchLength);
+            pos += matchLength;
+            anchor = pos;
+        }
+    }
+
+    emitSequence(out, src + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool Compression::decompress(const std::string& packed, std::string& data, size_t maxSize) {
+    if (packed.size() < 5) {
+        return false;
+    }
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(packed.data());
+    uint32_t rawSize = 0;
+    for (int i = 0; i < 4; ++i) rawSize |= static_cast<uint32_t>(in[i]) << (8 * i);
+    // 分配输出缓冲区之前先检查声明的长度
+    if (rawSize > maxSize || rawSize > (packed.size() - 4) * MAX_EXPANSION_RATIO) {
+        return false;
+    }
+
+    std::string out(rawSize, '\0');
+    size_t ip = 4;
+    size_t op = 0;
+    const size_t inSize = packed.size();
+
+    // 读取扩展长度字节
+    auto readLength = [&](size_t& length) {
+        unsigned char b;
+        do {
+            if (ip >= inSize) {
+                return false;
+            }
+            b = in[ip++];
+            length += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < inSize) {
+        unsigned char token = in[ip++];
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(literalLength)) {
+            return false;
+        }
+        if (literalLength > inSize - ip || literalLength > rawSize - op) {
+            return false;
+        }
+        std::memcpy(&out[op], in + ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // 最后一段只有字面量
+        if (ip == inSize) {
+            break;
+        }
+
+        if (inSize - ip < 2) {
+            return false;
+        }
+        size_t offset = in[ip] | (static_cast<size_t>(in[ip + 1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) {
+            return false;
+        }
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > rawSize - op) {
+            return false;
+        }
+        // 匹配可能与输出重叠，逐字节复制
+        for (size_t i = 0; i < matchLength; ++i) {
+            out[op + i] = out[op - offset + i];
+        }
+        op += matchLength;
+    }
+
+    if (op != rawSize) {
+        return false;
+    }
+    data = std::move(out);
+    return true;
+}
+
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string Compression::base64Encode(const std::string& data) {
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t n = (p[i] << 16) | (p[i + 1] << 8) | p[i + 2];
+        out.push_back(BASE64_ALPHABET[(n >> 18) & 63]);
+        out.push_back(BASE64_ALPHABET[(n >> 12) & 63]);
+        out.push_back(BASE64_ALPHABET[(n >> 6) & 63]);
+        out.push_back(BASE64_ALPHABET[n & 63]);
+    }
+    if (i + 1 == data.size()) {
+        uint32_t n = p[i] << 16;
+        out.push_back(BASE64_ALPHABET[(n >> 18) & 63]);
+        out.push_back(BASE64_ALPHABET[(n >> 12) & 63]);
+        out += "==";
+    } else if (i + 2 == data.size()) {
+        uint32_t n = (p[i] << 16) | (p[i + 1] << 8);
+        out.push_back(BASE64_ALPHABET[(n >> 18) & 63]);
+        out.push_back(BASE64_ALPHABET[(n >> 12) & 63]);
+        out.push_back(BASE64_ALPHABET[(n >> 6) & 63]);
+        out.push_back('=');
+    }
+    return out;
+}
+
+bool Compression::base64Decode(const std::string& text, std::string& data) {
+    static const auto lookup = [] {
+        std::vector<int> t(256, -1);
+        for (int i = 0; i < 64; ++i) {
+            t[static_cast<unsigned char>(BASE64_ALPHABET[i])] = i;
+        }
+        return t;
+    }();
+
+    if (text.size() % 4 != 0) {
+        return false;
+    }
+    std::string out;
+    out.reserve(text.size() / 4 * 3);
+    for (size_t i = 0; i < text.size(); i += 4) {
+        int values[4];
+        int padding = 0;
+        for (int k = 0; k < 4; ++k) {
+            char c = text[i + k];
+            // 只允许在最后一组的末尾出现填充
+            if (c == '=' && i + 4 == text.size() && k >= 2) {
+                values[k] = 0;
+                padding++;
+                continue;
+            }
+            if (padding > 0) {
+                return false;
+            }
+            values[k] = lookup[static_cast<unsigned char>(c)];
+            if (values[k] < 0) {
+                return false;
+            }
+        }
+        uint32_t n = (values[0] << 18) | (values[1] << 12) | (values[2] << 6) | values[3];
+        out.push_back(static_cast<char>((n >> 16) & 0xFF));
+        if (padding < 2) out.push_back(static_cast<char>((n >> 8) & 0xFF));
+        if (padding < 1) out.push_back(static_cast<char>(n & 0xFF));
+    }
+    data = std::move(out);
+    return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+// 区块压缩编解码：LZ4 块格式（在树内实现，无外部依赖）。
+// 压缩结果为 [原始长度 u32 小端][LZ4 块]，可以独立解压。
+// 另外提供 base64，用于把压缩数据放进 JSON 消息
+class Compression {
+public:
+    static std::string compress(const std::string& data);
+    // 数据损坏或原始长度超过 maxSize 时返回 false
+    static bool decompress(const std::string& packed, std::string& data,
+                           size_t maxSize = MAX_DECOMPRESSED_SIZE);
+
+    static std::string base64Encode(const std::string& data);
+    static bool base64Decode(const std::string& text, std::string& data);
+
+    // 解压后允许的最大长度，防止损坏或恶意的长度字段导致巨大分配
+    static const size_t MAX_DECOMPRESSED_SIZE = 256 * 1024 * 1024;
+    // 网络消息来自不受信任的对端，上限比本地存储的记录小得多
+    static const size_t MAX_MESSAGE_DECOMPRESSED_SIZE = 32 * 1024 * 1024;
+    // LZ4 每个输入字节最多展开为 255 个输出字节，声明的原始长度超过该比例的数据必然损坏
+    static const size_t MAX_EXPANSION_RATIO = 255;
+};
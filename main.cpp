@@ -2,10 +2,19 @@
 #include "p2p_node.h"
 #include <windows.h>
 
-void runNode(const std::string& host, int port) {
+void runNode(const std::string& host, int port, const std::string& assumeValid, uint64_t pruneMiB) {
     try {
-        // 创建区块链，设置难度为 4
-        auto blockchain = std::make_shared<Blockchain>(4);
+        // 创建区块链，设置难度为 4；每个节点使用独立的区块存储目录，重启后自动恢复
+        auto blockchain = std::make_shared<Blockchain>(4, "blocks_" + host + "_" + std::to_string(port));
+        if (!assumeValid.empty()) {
+            blockchain->setAssumeValid(assumeValid);
+        }
+        // 修剪模式与交易索引互斥
+        if (pruneMiB > 0) {
+            blockchain->enablePruning(pruneMiB * 1024 * 1024);
+        } else {
+            blockchain->enableTxIndex();
+        }
         P2PNode node(host, port, blockchain);
         
         node.start();
@@ -16,11 +25,15 @@ void runNode(const std::string& host, int port) {
 
         std::cout << "\nAvailable commands:" << std::endl;
         std::cout << "  connect <host> <port> - Connect to a node" << std::endl;
-        std::cout << "  mine - Mine a new block" << std::endl;
-        std::cout << "  balance <address> - Check balance" << std::endl;
-        std::cout << "  send <from> <to> <amount> - Send transaction" << std::endl;
+        std::cout << "  mine [address] - Mine a new block (fees are paid to address)" << std::endl;
+        std::cout << "  balance <address> [height] - Check balance (optionally at a height)" << std::endl;
+        std::cout << "  send <from> <to> <amount> [fee] - Send transaction" << std::endl;
         std::cout << "  peers - List connected peers" << std::endl;
         std::cout << "  chain - Show blockchain" << std::endl;
+        std::cout << "  sync - Headers-first sync with peers" << std::endl;
+        std::cout << "  tx <txid> - Look up a confirmed transaction" << std::endl;
+        std::cout << "  history <address> [cursor] - List transactions of an address" << std::endl;
+        std::cout << "  mempool - Show transaction pool usage" << std::endl;
         std::cout << "  exit - Stop the node" << std::endl;
         
         // 修改主循环，检查退出请求
@@ -46,6 +59,12 @@ void runNode(const std::string& host, int port) {
                 node.connect(peerHost, peerPort);
             }
             else if (cmd == "mine") {
+                // 指定地址后，之后出块的手续费都付给该地址
+                std::string minerAddress;
+                if (iss >> minerAddress) {
+                    blockchain->setMinerAddress(minerAddress);
+                }
+                
                 // 获取待处理交易
                 auto pendingTxs = blockchain->getPendingTransactions();
                 if (pendingTxs.empty()) {
@@ -57,22 +76,39 @@ void runNode(const std::string& host, int port) {
                 blockchain->addBlock(pendingTxs, true);
                 std::cout << "New block mined" << std::endl;
                 
+                auto lastBlock = blockchain->getLastBlock();
+                if (!lastBlock) {
+                    std::cout << "Mined block body is not available" << std::endl;
+                    continue;
+                }
+                
                 // 广播新区块
                 Message msg;
                 msg.type = MessageType::NEW_BLOCK;
-                msg.data = blockchain->getChain().back()->toJson();
+                msg.data = lastBlock->toJson();
                 node.broadcast(msg);
             }
             else if (cmd == "balance") {
                 std::string address;
+                int height;
                 iss >> address;
-                double balance = blockchain->getBalance(address);
-                std::cout << "Balance: " << balance << std::endl;
+                if (iss >> height) {
+                    std::cout << "Balance at height " << height << ": "
+                              << blockchain->getBalanceAtHeight(address, height) << std::endl;
+                } else {
+                    double balance = blockchain->getBalance(address);
+                    std::cout << "Balance: " << balance << std::endl;
+                }
             }
             else if (cmd == "send") {
                 std::string from, to;
                 double amount;
+                double fee = 0.0;
                 iss >> from >> to >> amount;
+                // 手续费可选，越高越早被打包
+                if (!(iss >> fee)) {
+                    fee = 0.0;
+                }
                 
                 // 获取发送者钱包
                 auto wallet = blockchain->getWalletByPublicKey(from);
@@ -82,7 +118,7 @@ void runNode(const std::string& host, int port) {
                 }
                 
                 // 创建交易
-                Transaction tx(from, to, amount);
+                Transaction tx(from, to, amount, fee);
                 
                 // 签名交易
                 tx.setSignature(wallet->sign(tx.toJson()));
@@ -108,14 +144,66 @@ void runNode(const std::string& host, int port) {
                 }
             }
             else if (cmd == "chain") {
-                const auto& chain = blockchain->getChain();
+                // 只读取区块头，不需要加载区块体；快照不受同时接入的区块影响
+                auto snapshot = blockchain->getSnapshot();
                 std::cout << "Blockchain:" << std::endl;
-                for (size_t i = 0; i < chain.size(); ++i) {
+                for (int i = 0; i < snapshot->getBlockCount(); ++i) {
+                    const auto& header = snapshot->getHeader(i);
                     std::cout << "Block " << i << ":" << std::endl;
-                    std::cout << "  Hash: " << chain[i]->getHash() << std::endl;
-                    std::cout << "  Transactions: " << chain[i]->getTransactions().size() << std::endl;
+                    std::cout << "  Hash: " << header.hash << std::endl;
+                    std::cout << "  Transactions: " << header.transactionCount << std::endl;
                 }
             }
+            else if (cmd == "tx") {
+                std::string txId;
+                iss >> txId;
+                Transaction tx;
+                TxLocation location;
+                if (!blockchain->getTransaction(txId, tx, &location)) {
+                    std::cout << "Transaction not found" << std::endl;
+                    continue;
+                }
+                std::cout << "Block " << location.height << ", position " << location.position << std::endl;
+                std::cout << "  " << tx.toJson() << std::endl;
+                std::vector<std::pair<std::string, bool>> proof;
+                std::string merkleRoot;
+                if (blockchain->getTransactionProof(txId, proof, merkleRoot)) {
+                    std::cout << "  Merkle root: " << merkleRoot << std::endl;
+                    for (const auto& [siblingHash, isLeft] : proof) {
+                        std::cout << "  " << (isLeft ? "R " : "L ") << siblingHash << std::endl;
+                    }
+                }
+            }
+            else if (cmd == "history") {
+                std::string address, cursor;
+                iss >> address >> cursor;
+                AddressHistoryPage page = blockchain->getAddressHistory(address, cursor);
+                for (const auto& entry : page.entries) {
+                    if (entry.height < 0) {
+                        std::cout << "  pending  " << entry.txId << std::endl;
+                    } else {
+                        std::cout << "  block " << entry.height << "  " << entry.txId << std::endl;
+                    }
+                }
+                if (!page.nextCursor.empty()) {
+                    std::cout << "More: history " << address << " " << page.nextCursor << std::endl;
+                }
+            }
+            else if (cmd == "mempool") {
+                TransactionPoolStats stats = blockchain->getTransactionPoolStats();
+                std::cout << "Transactions: " << stats.transactions << std::endl;
+                std::cout << "Memory: " << stats.memoryUsage << " / " << stats.maxMemoryBytes << " bytes" << std::endl;
+                std::cout << "Evicted: " << stats.evicted << ", expired: " << stats.expired
+                          << ", rejected (full): " << stats.rejectedFull << std::endl;
+                TxIngestStats ingest = node.getTxIngestStats();
+                std::cout << "Received: " << ingest.received << ", accepted: " << ingest.accepted
+                          << ", rejected: " << ingest.rejected << ", dropped: " << ingest.dropped
+                          << ", queued: " << ingest.queued << std::endl;
+            }
+            else if (cmd == "sync") {
+                node.requestHeaders();
+                std::cout << "Requested headers from peers" << std::endl;
+            }
             else {
                 std::cout << "Unknown command" << std::endl;
             }
@@ -197,11 +285,13 @@ bool sendExitSignal(const std::string& host, int port) {
 }
 
 int main(int argc, char* argv[]) {
-    if (argc == 3) {
-        // 作为节点进程运行
+    if (argc >= 3 && argc <= 5) {
+        // 作为节点进程运行：<host> <port> [assume-valid 区块哈希，"-" 表示不使用] [修剪预算MiB]
         std::string host = argv[1];
         int port = std::stoi(argv[2]);
-        runNode(host, port);
+        std::string assumeValid = argc >= 4 && std::string(argv[3]) != "-" ? argv[3] : "";
+        uint64_t pruneMiB = argc == 5 ? std::stoull(argv[4]) : 0;
+        runNode(host, port, assumeValid, pruneMiB);
     } else {
         // 主进程，创建三个节点
         std::cout << "Starting three nodes..." << std::endl;
@@ -4,6 +4,19 @@
 #include <iomanip>
 #include <algorithm>
 #include <iostream>
+#include <atomic>
+#include <thread>
+#include "threadpool.h"
+
+// 每个并行任务负责的父节点数，避免一个任务只算一次哈希
+static const size_t PAIRS_PER_TASK = 256;
+static std::atomic<size_t> parallelThreshold{MerkleTree::DEFAULT_PARALLEL_THRESHOLD};
+
+// 构建大型Merkle树用的共享线程池，第一次需要时才创建
+static ThreadPool& merklePool() {
+    static ThreadPool pool;
+    return pool;
+}
 
 // Helper function for calculating SHA256 hash
 static std::string calculateHash(const std::string& data) {
@@ -27,7 +40,6 @@ MerkleNode::MerkleNode(const std::string& hash, const std::string& name)
     , right_(nullptr)
     , level_(0)
 {
-    std::cout << "  MerkleNode::MerkleNode " << name_ << " " << hash_ << std::endl;
 }
 
 MerkleNode::MerkleNode(std::shared_ptr<MerkleNode> left, std::shared_ptr<MerkleNode> right)
@@ -36,9 +48,9 @@ MerkleNode::MerkleNode(std::shared_ptr<MerkleNode> left, std::shared_ptr<MerkleN
     , level_(std::max(left->getLevel(), right ? right->getLevel() : 0) + 1)
     , name_(left->getName() + (right ? right->getName() : left->getName()))
 {
+    // 不在这里逐个节点输出日志：大型树的父节点在线程池中并行构造，日志会争用 std::cout 并交错
     std::string combined = left->getHash() + (right ? right->getHash() : left->getHash());
     hash_ = calculateHash(combined);
-    std::cout << "  MerkleNode::MerkleNode " << name_ << " " << hash_ << std::endl;
 }
 
 MerkleTree::MerkleTree(const std::vector<Transaction>& transactions) {
@@ -87,6 +99,26 @@ bool MerkleTree::verifyTransaction(const Transaction& transaction) const {
     return verifyPath(txHash, it->second);
 }
 
+bool MerkleTree::getProof(const std::string& txHash, std::vector<std::pair<std::string, bool>>& proof) const {
+    auto it = proofPaths_.find(txHash);
+    if (it == proofPaths_.end()) {
+        return false;
+    }
+    // proofPaths_ 按从根到叶子的顺序保存，证明按从叶子到根的顺序给出
+    proof.assign(it->second.rbegin(), it->second.rend());
+    return true;
+}
+
+bool MerkleTree::verifyProof(const std::string& txHash, const std::vector<std::pair<std::string, bool>>& proof,
+                             const std::string& rootHash) {
+    std::string currentHash = txHash;
+    for (const auto& [siblingHash, currentIsLeft] : proof) {
+        currentHash = currentIsLeft ? ::calculateHash(currentHash + siblingHash)
+                                    : ::calculateHash(siblingHash + currentHash);
+    }
+    return currentHash == rootHash;
+}
+
 void MerkleTree::buildProofPaths(std::shared_ptr<MerkleNode> node, const std::vector<std::pair<std::string, bool>>& path, int level) {
     if (!node) return;
     std::string indent(level * 2, ' ');
@@ -157,16 +189,31 @@ void MerkleTree::printNode(std::shared_ptr<MerkleNode> node, int level) const {
 }
 
 std::shared_ptr<MerkleNode> MerkleTree::buildTree(const std::vector<std::shared_ptr<MerkleNode>>& nodes, int level) {
-    std::cout << "  MerkleTree::buildTree " << std::endl;
+    std::cout << "  MerkleTree::buildTree level " << level << ", " << nodes.size() << " nodes" << std::endl;
     if (nodes.empty()) return nullptr;
 
-    std::vector<std::shared_ptr<MerkleNode>> newNodes;
-    for (size_t i = 0; i < nodes.size(); i += 2) {
-        auto left = nodes[i];
-        auto right = (i + 1 < nodes.size()) ? nodes[i + 1] : left;
-        auto parent = std::make_shared<MerkleNode>(left, right);
-        parent->setLevel(level + 1);
-        newNodes.push_back(parent);
+    // 同一层的各个父节点互不依赖，节点数较多时分块并行计算
+    std::vector<std::shared_ptr<MerkleNode>> newNodes((nodes.size() + 1) / 2);
+    auto buildParents = [&nodes, &newNodes, level](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            size_t i = p * 2;
+            auto left = nodes[i];
+            auto right = (i + 1 < nodes.size()) ? nodes[i + 1] : left;
+            auto parent = std::make_shared<MerkleNode>(left, right);
+            parent->setLevel(level + 1);
+            newNodes[p] = parent;
+        }
+    };
+    // 单核机器上并行只会增加调度开销
+    static const bool multiCore = std::thread::hardware_concurrency() > 1;
+    if (multiCore && nodes.size() >= parallelThreshold) {
+        size_t tasks = (newNodes.size() + PAIRS_PER_TASK - 1) / PAIRS_PER_TASK;
+        merklePool().parallelFor(tasks, [&](size_t task) {
+            size_t begin = task * PAIRS_PER_TASK;
+            buildParents(begin, std::min(begin + PAIRS_PER_TASK, newNodes.size()));
+        });
+    } else {
+        buildParents(0, newNodes.size());
     }
 
     if (newNodes.size() == 1) {
@@ -178,4 +225,59 @@ std::shared_ptr<MerkleNode> MerkleTree::buildTree(const std::vector<std::shared_
 
 std::string MerkleTree::calculateHash(const std::string& data) const {
     return ::calculateHash(data);
+}
+
+void MerkleTree::setParallelThreshold(size_t nodes) {
+    parallelThreshold = std::max<size_t>(nodes, 2);
+}
+
+size_t MerkleTree::getParallelThreshold() {
+    return parallelThreshold;
+}
+
+void MerkleAccumulator::append(const std::string& leafHash) {
+    // 与二进制加一相同：逐层和等待中的左兄弟合并，直到遇到空位
+    std::string carry = leafHash;
+    size_t level = 0;
+    while (level < frontier_.size() && !frontier_[level].empty()) {
+        carry = ::calculateHash(frontier_[level] + carry);
+        frontier_[level].clear();
+        level++;
+    }
+    if (level == frontier_.size()) {
+        frontier_.push_back(carry);
+    } else {
+        frontier_[level] = carry;
+    }
+    count_++;
+}
+
+std::string MerkleAccumulator::getRootHash() const {
+    if (count_ == 0) {
+        return "";
+    }
+    // MerkleTree 至少合并一次，根所在的层为 max(1, ceil(log2 n))
+    size_t rootLevel = 1;
+    while ((size_t(1) << rootLevel) < count_) {
+        rootLevel++;
+    }
+
+    // 从最低层向上折叠边界；carry 是当前层最右边那个不完整子树的根
+    std::string carry;
+    for (size_t level = 0; level < rootLevel; ++level) {
+        const std::string* left = level < frontier_.size() && !frontier_[level].empty() ? &frontier_[level] : nullptr;
+        if (left && !carry.empty()) {
+            carry = ::calculateHash(*left + carry);
+        } else if (left) {
+            // 该层最后一个节点落单，与自身配对
+            carry = ::calculateHash(*left + *left);
+        } else if (!carry.empty()) {
+            carry = ::calculateHash(carry + carry);
+        }
+    }
+    // 叶子数是2的幂时整棵树就是边界上最高的完整子树
+    if (carry.empty()) {
+        return frontier_[rootLevel];
+    }
+    return carry;
 } 
\ No newline at end of file
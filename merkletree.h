@@ -32,8 +32,17 @@ public:
     
     std::string getRootHash() const;
     bool verifyTransaction(const Transaction& transaction) const;
+    // Merkle证明：从叶子到根的兄弟节点哈希，bool 为 true 时当前哈希在左、兄弟在右
+    bool getProof(const std::string& txHash, std::vector<std::pair<std::string, bool>>& proof) const;
+    static bool verifyProof(const std::string& txHash, const std::vector<std::pair<std::string, bool>>& proof,
+                            const std::string& rootHash);
     void printTree() const;
 
+    // 某一层的节点数达到该阈值时，这一层的配对哈希分给共享线程池并行计算
+    static void setParallelThreshold(size_t nodes);
+    static size_t getParallelThreshold();
+    static const size_t DEFAULT_PARALLEL_THRESHOLD = 2048;
+
 private:
     std::shared_ptr<MerkleNode> root_;
     std::map<std::string, std::vector<std::pair<std::string, bool>>> proofPaths_;
@@ -46,4 +55,18 @@ private:
                                         int level = 0);
     void printNode(std::shared_ptr<MerkleNode> node, int level = 0) const;
     std::string calculateHash(const std::string& data) const;
+};
+
+// 只追加的Merkle累加器：只保存右侧边界（每层最多一个等待配对的完整子树根），
+// 追加一个叶子和计算根都是 O(log n)。规则与 MerkleTree 相同：每层末尾落单的节点与自身配对，
+// 只有一个叶子时根为 H(a+a)，因此相同的叶子序列得到与 MerkleTree::getRootHash 相同的根
+class MerkleAccumulator {
+public:
+    void append(const std::string& leafHash);
+    std::string getRootHash() const;
+    size_t size() const { return count_; }
+
+private:
+    std::vector<std::string> frontier_;  // 第 level 层等待右兄弟的子树根，空字符串表示没有
+    size_t count_ = 0;
 }; 
\ No newline at end of file
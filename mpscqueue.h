@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+// 无锁的多生产者单消费者队列（链表 + 哨兵节点）。
+// push 可以在任意线程调用，只用一次原子交换；pop 和 empty 只能由唯一的消费者线程调用。
+// 生产者完成交换但还没链接 next 的短暂窗口内，消费者会暂时看到队列为空
+template <typename T>
+class MPSCQueue {
+public:
+    MPSCQueue() : head_(new Node()), tail_(head_.load()) {}
+
+    ~MPSCQueue() {
+        T value;
+        while (pop(value)) {
+        }
+        delete tail_;
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T& value) {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        // next 成为新的哨兵节点
+        value = std::move(*next->value);
+        next->value.reset();
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+    bool empty() const {
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> value;
+
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+    };
+
+    // 生产者和消费者各自访问的指针放在不同的缓存行，避免互相争用
+    alignas(64) std::atomic<Node*> head_;  // 最后入队的节点，生产者共享
+    alignas(64) Node* tail_;               // 哨兵节点，只有消费者访问
+};
@@ -0,0 +1,137 @@
+#include "muhash.h"
+#include <openssl/sha.h>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+
+static const int MUHASH_BYTES = 384;  // 3072 位
+
+// 把 BN 运算的失败统一转换为异常
+static void checkBN(int ok, const char* what) {
+    if (!ok) {
+        throw std::runtime_error(std::string("MuHash: ") + what + " failed");
+    }
+}
+
+MuHash::MuHash()
+    : numerator_(BN_new())
+    , denominator_(BN_new())
+{
+    if (!numerator_ || !denominator_) {
+        BN_free(numerator_);
+        BN_free(denominator_);
+        throw std::runtime_error("Failed to create MuHash");
+    }
+    BN_one(numerator_);
+    BN_one(denominator_);
+}
+
+MuHash::MuHash(const MuHash& other)
+    : numerator_(BN_dup(other.numerator_))
+    , denominator_(BN_dup(other.denominator_))
+{
+    if (!numerator_ || !denominator_) {
+        BN_free(numerator_);
+        BN_free(denominator_);
+        throw std::runtime_error("Failed to copy MuHash");
+    }
+}
+
+MuHash& MuHash::operator=(const MuHash& other) {
+    if (this != &other) {
+        checkBN(BN_copy(numerator_, other.numerator_) != nullptr, "copy");
+        checkBN(BN_copy(denominator_, other.denominator_) != nullptr, "copy");
+    }
+    return *this;
+}
+
+MuHash::~MuHash() {
+    BN_free(numerator_);
+    BN_free(denominator_);
+}
+
+const BIGNUM* MuHash::modulus() {
+    // p = 2^3072 - 1103717，是小于 2^3072 的最大安全素数
+    static const BIGNUM* p = [] {
+        BIGNUM* value = BN_new();
+        BN_zero(value);
+        BN_set_bit(value, 3072);
+        BN_sub_word(value, 1103717);
+        return value;
+    }();
+    return p;
+}
+
+BIGNUM* MuHash::toElement(const std::string& data) {
+    // 用 SHA256(data || counter) 扩展出 384 字节，作为群中的元素
+    unsigned char buffer[MUHASH_BYTES];
+    for (int i = 0; i < MUHASH_BYTES / SHA256_DIGEST_LENGTH; ++i) {
+        unsigned char counter = static_cast<unsigned char>(i);
+        SHA256_CTX sha256;
+        SHA256_Init(&sha256);
+        SHA256_Update(&sha256, data.c_str(), data.size());
+        SHA256_Update(&sha256, &counter, 1);
+        SHA256_Final(buffer + i * SHA256_DIGEST_LENGTH, &sha256);
+    }
+
+    BIGNUM* element = BN_bin2bn(buffer, MUHASH_BYTES, nullptr);
+    checkBN(element != nullptr, "bin2bn");
+    // 大于等于 p 的概率可以忽略，但仍然规约一次以保证落在群内
+    if (BN_cmp(element, modulus()) >= 0) {
+        checkBN(BN_sub(element, element, modulus()), "reduce");
+    }
+    return element;
+}
+
+void MuHash::insert(const std::string& data) {
+    BIGNUM* element = toElement(data);
+    BN_CTX* ctx = BN_CTX_new();
+    int ok = ctx && BN_mod_mul(numerator_, numerator_, element, modulus(), ctx);
+    BN_CTX_free(ctx);
+    BN_free(element);
+    checkBN(ok, "insert");
+}
+
+void MuHash::remove(const std::string& data) {
+    BIGNUM* element = toElement(data);
+    BN_CTX* ctx = BN_CTX_new();
+    int ok = ctx && BN_mod_mul(denominator_, denominator_, element, modulus(), ctx);
+    BN_CTX_free(ctx);
+    BN_free(element);
+    checkBN(ok, "remove");
+}
+
+void MuHash::combine(const MuHash& other) {
+    BN_CTX* ctx = BN_CTX_new();
+    int ok = ctx
+        && BN_mod_mul(numerator_, numerator_, other.numerator_, modulus(), ctx)
+        && BN_mod_mul(denominator_, denominator_, other.denominator_, modulus(), ctx);
+    BN_CTX_free(ctx);
+    checkBN(ok, "combine");
+}
+
+std::string MuHash::finalize() const {
+    BN_CTX* ctx = BN_CTX_new();
+    BIGNUM* result = BN_new();
+    // result = numerator / denominator (mod p)，只有查询时才做一次求逆
+    int ok = ctx && result
+        && BN_mod_inverse(result, denominator_, modulus(), ctx) != nullptr
+        && BN_mod_mul(result, result, numerator_, modulus(), ctx);
+
+    unsigned char buffer[MUHASH_BYTES];
+    if (ok) {
+        ok = BN_bn2binpad(result, buffer, MUHASH_BYTES) == MUHASH_BYTES;
+    }
+    BN_free(result);
+    BN_CTX_free(ctx);
+    checkBN(ok, "finalize");
+
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(buffer, MUHASH_BYTES, hash);
+
+    std::stringstream ss;
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+        ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(hash[i]);
+    }
+    return ss.str();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <openssl/bn.h>
+
+// 滚动多重集合哈希（MuHash3072）
+// 集合中的每个元素映射为模素数 p = 2^3072 - 1103717 的乘法群中的一个数，
+// 集合的承诺就是所有元素的乘积。添加元素乘到分子上，删除元素乘到分母上，
+// 每次更新都是 O(1)，与集合大小无关；元素的添加顺序不影响结果。
+class MuHash {
+public:
+    MuHash();
+    MuHash(const MuHash& other);
+    MuHash& operator=(const MuHash& other);
+    ~MuHash();
+
+    // 向集合中添加一个元素
+    void insert(const std::string& data);
+    // 从集合中删除一个元素（调用者保证该元素确实在集合中）
+    void remove(const std::string& data);
+    // 合并另一个集合的承诺
+    void combine(const MuHash& other);
+
+    // 计算当前集合的承诺值（SHA256 十六进制字符串）
+    std::string finalize() const;
+
+private:
+    BIGNUM* numerator_;
+    BIGNUM* denominator_;
+
+    static const BIGNUM* modulus();
+    static BIGNUM* toElement(const std::string& data);
+};
@@ -0,0 +1,124 @@
+#include "orphanpool.h"
+#include <iostream>
+
+constexpr std::chrono::seconds OrphanPool::DEFAULT_EXPIRY;
+
+OrphanPool::OrphanPool(size_t maxBytes, size_t maxBlocks, std::chrono::seconds expiry)
+    : maxBytes_(maxBytes)
+    , maxBlocks_(maxBlocks)
+    , expiry_(expiry)
+    , usedBytes_(0)
+{
+}
+
+bool OrphanPool::add(const std::shared_ptr<Block>& block, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string& hash = block->getHash();
+    if (byHash_.find(hash) != byHash_.end()) {
+        return false;
+    }
+
+    size_t bytes = block->estimateSize();
+    byHash_[hash] = {block, bytes, now};
+    byPrevHash_.emplace(block->getPreviousHash(), hash);
+    byHeight_.emplace(block->getIndex(), hash);
+    usedBytes_ += bytes;
+    evictLocked();
+
+    bool kept = byHash_.find(hash) != byHash_.end();
+    std::cout << "OrphanPool: " << (kept ? "buffered" : "evicted") << " block " << block->getIndex()
+              << " (" << byHash_.size() << " orphans, " << usedBytes_ << " bytes)" << std::endl;
+    return kept;
+}
+
+bool OrphanPool::contains(const std::string& hash) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return byHash_.find(hash) != byHash_.end();
+}
+
+std::vector<std::shared_ptr<Block>> OrphanPool::takeChildren(const std::string& parentHash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::shared_ptr<Block>> children;
+    auto range = byPrevHash_.equal_range(parentHash);
+    std::vector<std::string> hashes;
+    for (auto it = range.first; it != range.second; ++it) {
+        hashes.push_back(it->second);
+    }
+    for (const auto& hash : hashes) {
+        children.push_back(byHash_[hash].block);
+        removeLocked(hash);
+    }
+    return children;
+}
+
+size_t OrphanPool::prune(int height, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> stale;
+    for (auto it = byHeight_.begin(); it != byHeight_.end() && it->first < height; ++it) {
+        stale.push_back(it->second);
+    }
+    for (const auto& [hash, entry] : byHash_) {
+        if (entry.block->getIndex() >= height && now - entry.received > expiry_) {
+            stale.push_back(hash);
+        }
+    }
+    for (const auto& hash : stale) {
+        removeLocked(hash);
+    }
+    if (!stale.empty()) {
+        std::cout << "OrphanPool: pruned " << stale.size() << " stale orphans" << std::endl;
+    }
+    return stale.size();
+}
+
+void OrphanPool::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    byHash_.clear();
+    byPrevHash_.clear();
+    byHeight_.clear();
+    usedBytes_ = 0;
+}
+
+size_t OrphanPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return byHash_.size();
+}
+
+size_t OrphanPool::getUsedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return usedBytes_;
+}
+
+void OrphanPool::removeLocked(const std::string& hash) {
+    auto it = byHash_.find(hash);
+    if (it == byHash_.end()) {
+        return;
+    }
+    const Block& block = *it->second.block;
+
+    auto prevRange = byPrevHash_.equal_range(block.getPreviousHash());
+    for (auto p = prevRange.first; p != prevRange.second; ++p) {
+        if (p->second == hash) {
+            byPrevHash_.erase(p);
+            break;
+        }
+    }
+    auto heightRange = byHeight_.equal_range(block.getIndex());
+    for (auto h = heightRange.first; h != heightRange.second; ++h) {
+        if (h->second == hash) {
+            byHeight_.erase(h);
+            break;
+        }
+    }
+
+    usedBytes_ -= it->second.bytes;
+    byHash_.erase(it);
+}
+
+void OrphanPool::evictLocked() {
+    // 离链尾最远的孤块最晚才能用上，先淘汰它们
+    while (!byHeight_.empty() && (usedBytes_ > maxBytes_ || byHash_.size() > maxBlocks_)) {
+        std::string victim = std::prev(byHeight_.end())->second;
+        removeLocked(victim);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "block.h"
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+// 孤块缓冲区：暂存父区块尚未接入链的区块（例如从多个节点并发下载时提前到达的区块）。
+// 按前一区块哈希和高度索引；超出字节或数量上限时先淘汰离链尾最远的区块，过期的区块被丢弃
+class OrphanPool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    OrphanPool(size_t maxBytes = DEFAULT_MAX_BYTES,
+               size_t maxBlocks = DEFAULT_MAX_BLOCKS,
+               std::chrono::seconds expiry = DEFAULT_EXPIRY);
+
+    // 加入一个孤块；返回 false 表示已存在或因超限被立即淘汰
+    bool add(const std::shared_ptr<Block>& block, Clock::time_point now = Clock::now());
+    bool contains(const std::string& hash) const;
+    // 取出（并移除）所有以 parentHash 为前一区块的孤块
+    std::vector<std::shared_ptr<Block>> takeChildren(const std::string& parentHash);
+    // 丢弃已过期的孤块和高度低于 height 的孤块（它们已经不可能接入链），返回丢弃数量
+    size_t prune(int height, Clock::time_point now = Clock::now());
+    void clear();
+
+    size_t size() const;
+    size_t getUsedBytes() const;
+
+    static const size_t DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+    static const size_t DEFAULT_MAX_BLOCKS = 256;
+    static constexpr std::chrono::seconds DEFAULT_EXPIRY{20 * 60};
+
+private:
+    struct Entry {
+        std::shared_ptr<Block> block;
+        size_t bytes;
+        Clock::time_point received;
+    };
+
+    size_t maxBytes_;
+    size_t maxBlocks_;
+    std::chrono::seconds expiry_;
+    size_t usedBytes_;
+    std::unordered_map<std::string, Entry> byHash_;                  // 区块哈希 -> 孤块
+    std::unordered_multimap<std::string, std::string> byPrevHash_;   // 前一区块哈希 -> 区块哈希
+    std::multimap<int, std::string> byHeight_;                       // 高度 -> 区块哈希
+    mutable std::mutex mutex_;
+
+    void removeLocked(const std::string& hash);
+    void evictLocked();
+};
@@ -3,11 +3,23 @@
 #include <sstream>
 #include <nlohmann/json.hpp>
 #include "wallet.h"
+#include "compression.h"
+#include <chrono>
 
 using json = nlohmann::json;
 
 P2PNode::P2PNode(const std::string& host, int port, std::shared_ptr<Blockchain> blockchain)
     : host_(host), port_(port), blockchain_(blockchain),
+      block_validator_(*blockchain, validation_pool_),
+      tx_ingestor_(*blockchain, validation_pool_,
+                   [this](const Transaction&, const std::string& payload, const std::string& sender) {
+                       // 广播给其他节点，但排除发送节点；sender 设为本节点，下游节点转发时不会再发回来
+                       Message relay;
+                       relay.type = MessageType::NEW_TRANSACTION;
+                       relay.sender = host_ + ":" + std::to_string(port_);
+                       relay.data = payload;
+                       broadcastMessage(relay, sender);
+                   }),
       acceptor_(io_context_, tcp::endpoint(boost::asio::ip::make_address(host), port)),
       running_(false) {
 }
@@ -21,6 +33,7 @@ void P2PNode::start() {
     std::cout << "  " << host_ << ":" << port_ << " Starting node..." << std::endl;
 
     running_ = true;
+    tx_ingestor_.start();
     message_thread_ = std::thread(&P2PNode::messageLoop, this);
     std::cout << "  " << host_ << ":" << port_ << " messageLoop..." << std::endl;
     // 在单独的线程中运行 io_context_
@@ -37,16 +50,22 @@ void P2PNode::start() {
 
 void P2PNode::stop() {
     running_ = false;
+    // 交易接收流水线会广播交易，先于连接停止
+    tx_ingestor_.stop();
     
     // 1. 先关闭所有连接
-    for (auto& conn : connections_) {
+    std::map<std::string, std::shared_ptr<tcp::socket>> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.swap(connections_);
+    }
+    for (auto& conn : connections) {
         try {
             conn.second->close();
         } catch (...) {
             // 忽略关闭时的错误
         }
     }
-    connections_.clear();
     
     // 2. 然后停止 io_context_
     io_context_.stop();
@@ -66,7 +85,7 @@ void P2PNode::connect(const std::string& host, int port) {
     try {
         // 检查是否已经连接
         std::string nodeId = host + ":" + std::to_string(port);
-        if (connections_.find(nodeId) != connections_.end()) {
+        if (findConnection(nodeId)) {
             std::cout << "Already connected to node: " << nodeId << std::endl;
             return;
         }
@@ -83,13 +102,27 @@ void P2PNode::connect(const std::string& host, int port) {
         // 连接到目标节点
         socket->connect(tcp::endpoint(boost::asio::ip::make_address(host), port));
         
-        // 保存连接信息
-        connections_[nodeId] = socket;
+        // 保存连接信息；连接期间其他线程可能已经建立了同一个连接
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            if (!connections_.emplace(nodeId, socket).second) {
+                std::cout << "Already connected to node: " << nodeId << std::endl;
+                return;
+            }
+        }
         
         // 发送握手消息
         Message handshake;
         handshake.type = MessageType::HANDSHAKE;
         handshake.sender = host_ + ":" + std::to_string(port_);
+        // 携带链高度和UTXO集合承诺，对端可以直接比较两边的状态；三者取自同一个快照
+        auto snapshot = blockchain_->getSnapshot();
+        handshake.data = json({
+            {"height", snapshot->getBlockCount()},
+            {"last_block_hash", snapshot->getTip().hash},
+            {"utxo_commitment", snapshot->getUTXOCommitment(snapshot->getBlockCount() - 1)},
+            {"compression", json::array({"lz4"})}
+        }).dump();
         sendToNode(nodeId, handshake);
         
         std::cout << "Connected to node: " << nodeId << std::endl;
@@ -114,36 +147,56 @@ void P2PNode::broadcastMessage(const Message& message, const std::string& exclud
         processed_messages_.insert(message_id);
     }
     
-    // 广播给除发送节点外的所有节点
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    for (const auto& [nodeId, socket] : connections_) {
+    // 广播给除发送节点外的所有节点；遍历的是节点列表的副本，发送失败时 sendToNode 会移除连接
+    for (const auto& nodeId : getConnectedNodes()) {
         if (nodeId != exclude_node) {
             sendToNode(nodeId, message);
         }
     }
 }
 
+std::shared_ptr<tcp::socket> P2PNode::findConnection(const std::string& nodeId) const {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    auto it = connections_.find(nodeId);
+    return it != connections_.end() ? it->second : nullptr;
+}
+
 void P2PNode::sendToNode(const std::string& nodeId, const Message& message) {
+    auto socket = findConnection(nodeId);
+    if (!socket) {
+        return;
+    }
     try {
-        auto it = connections_.find(nodeId);
-        if (it != connections_.end()) {
-            std::string serialized = serializeMessage(message);
-            boost::asio::write(*it->second, boost::asio::buffer(serialized));
-        }
+        bool compress = message.data.size() >= COMPRESSION_THRESHOLD && peerSupportsCompression(nodeId);
+        std::string serialized = serializeMessage(message, compress);
+        boost::asio::write(*socket, boost::asio::buffer(serialized));
     } catch (const std::exception& e) {
         std::cerr << "Failed to send message to node " << nodeId << ": " << e.what() << std::endl;
-        connections_.erase(nodeId);
+        {
+            // 只移除发送失败的这个连接，期间重新建立的连接保留
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            auto it = connections_.find(nodeId);
+            if (it != connections_.end() && it->second == socket) {
+                connections_.erase(it);
+            }
+        }
+        releaseBlockBodies(nodeId);
     }
 }
 
 std::vector<std::string> P2PNode::getConnectedNodes() const {
     std::vector<std::string> nodes;
+    std::lock_guard<std::mutex> lock(connections_mutex_);
     for (const auto& [nodeId, _] : connections_) {
         nodes.push_back(nodeId);
     }
     return nodes;
 }
 
+TxIngestStats P2PNode::getTxIngestStats() const {
+    return tx_ingestor_.getStats();
+}
+
 void P2PNode::handleNewConnection() {
     acceptor_.async_accept(
         [this](boost::system::error_code ec, tcp::socket socket) {
@@ -153,10 +206,14 @@ void P2PNode::handleNewConnection() {
                                    std::to_string(socket.remote_endpoint().port());
                 std::cout << "  " << host_ << ":" << port_ << " New connection from: " << nodeId << std::endl;
                 // 2. 保存连接信息
-                connections_[nodeId] = std::make_shared<tcp::socket>(std::move(socket));
+                auto peerSocket = std::make_shared<tcp::socket>(std::move(socket));
+                {
+                    std::lock_guard<std::mutex> lock(connections_mutex_);
+                    connections_[nodeId] = peerSocket;
+                }
                 // 3. 开始异步读取 所以这里不是开始异步读取，而是设置异步读取
                 auto buffer = std::make_shared<boost::asio::streambuf>();
-                boost::asio::async_read_until(*connections_[nodeId], *buffer, "\n",
+                boost::asio::async_read_until(*peerSocket, *buffer, "\n",
                     [this, nodeId, buffer](boost::system::error_code ec, std::size_t length) {
                         // 4. 处理读取到的数据
                         if (!ec) {
@@ -164,7 +221,13 @@ void P2PNode::handleNewConnection() {
                             std::string data(boost::asio::buffers_begin(buffer->data()),
                                           boost::asio::buffers_begin(buffer->data()) + length);
                             buffer->consume(length);
-                            Message message = deserializeMessage(data);
+                            Message message;
+                            try {
+                                message = deserializeMessage(data);
+                            } catch (const std::exception& e) {
+                                std::cerr << "Dropping malformed message from " << nodeId << ": " << e.what() << std::endl;
+                                return;
+                            }
                             // 6. 处理消息
                             // handleMessage(message, nodeId);
                             // 将消息放入队列
@@ -183,9 +246,36 @@ void P2PNode::handleNewConnection() {
 
 void P2PNode::handleMessage(const Message& message, const std::string& sender) {
     switch (message.type) {
-        case MessageType::HANDSHAKE:
+        case MessageType::HANDSHAKE: {
             std::cout << "  " << host_ << ":" << port_ << " Received handshake from: " << sender << std::endl;
+            if (message.data.empty()) {
+                break;
+            }
+            // 比较同一高度上的UTXO集合承诺
+            json handshakeData = json::parse(message.data);
+            // 对端能解压 LZ4，之后发给它的大消息可以压缩
+            if (handshakeData.contains("compression") && handshakeData["compression"].is_array()) {
+                for (const auto& codec : handshakeData["compression"]) {
+                    if (codec == "lz4") {
+                        std::lock_guard<std::mutex> lock(compression_peers_mutex_);
+                        compression_peers_.insert(sender);
+                    }
+                }
+            }
+            if (handshakeData.contains("height") && handshakeData.contains("utxo_commitment")) {
+                int peerHeight = handshakeData["height"];
+                std::string peerCommitment = handshakeData["utxo_commitment"];
+                std::string localCommitment = blockchain_->getUTXOCommitmentAtHeight(peerHeight - 1);
+                if (localCommitment.empty()) {
+                    std::cout << "Peer " << sender << " is ahead of us (height " << peerHeight << ")" << std::endl;
+                } else if (localCommitment == peerCommitment) {
+                    std::cout << "UTXO set matches peer " << sender << " at height " << peerHeight << std::endl;
+                } else {
+                    std::cout << "UTXO set differs from peer " << sender << " at height " << peerHeight << std::endl;
+                }
+            }
             break;
+        }
             
         case MessageType::NEW_BLOCK: {
             // 处理新区块
@@ -235,11 +325,10 @@ void P2PNode::handleMessage(const Message& message, const std::string& sender) {
         case MessageType::NEW_TRANSACTION: {
             // 处理新交易
             std::cout << "  " << host_ << ":" << port_ << " Received new transaction from: " << sender << std::endl;
-            json txData = json::parse(message.data);
-            Transaction newTx(txData);
-            if (blockchain_->addTransactionToPool(newTx)) {
-                // 广播给其他节点，但排除发送节点
-                broadcastMessage(message, sender);
+            // 解析和验证交给接收流水线，消息线程继续处理区块等其他消息；通过后由流水线广播
+            if (!tx_ingestor_.submit(message.data, sender)) {
+                std::cout << "  " << host_ << ":" << port_ << " Transaction queue full, dropped transaction from: "
+                          << sender << std::endl;
             }
             break;
         }
@@ -249,20 +338,10 @@ void P2PNode::handleMessage(const Message& message, const std::string& sender) {
             std::cout << "  " << host_ << ":" << port_ << " Received get blocks from: " << sender << std::endl;
             json request = json::parse(message.data);
             int startHeight = request["start_height"];
-            std::vector<Block> blocks = blockchain_->getBlocksFromHeight(startHeight);
-            
-            Message response;
-            response.type = MessageType::BLOCKS;
-            
-            // 将区块列表转换为 JSON 数组
-            json blocksArray = json::array();
-            for (const auto& block : blocks) {
-                json blockJson = json::parse(block.toJson());
-                blocksArray.push_back(blockJson);
+            if (rejectIfPruned(sender, "GET_BLOCKS", startHeight)) {
+                break;
             }
-            response.data = blocksArray.dump();
-            
-            sendToNode(sender, response);
+            sendBlocksFrom(sender, startHeight);
             break;
         }
         
@@ -270,9 +349,16 @@ void P2PNode::handleMessage(const Message& message, const std::string& sender) {
             // 处理接收到的区块
             std::cout << "  " << host_ << ":" << port_ << " Received blocks from: " << sender << std::endl;
             json blocksData = json::parse(message.data);
-            for (const auto& blockData : blocksData) {
-                Block block(blockData);
-                blockchain_->addBlock(block.getTransactions(), false);
+            block_validator_.process(blocksData);
+            // 这批回复结束了对该节点的在途请求，没送来的区块体会在下一批中重新请求
+            size_t requested = releaseBlockBodies(sender);
+            // 区块头优先同步时，继续下载剩余的区块体；请求了却一个都没送来说明对端没有，换其他节点
+            if (!blockchain_->getMissingBlockHashes(1).empty()) {
+                if (requested > 0 && blocksData.empty()) {
+                    requestBlockBodiesElsewhere(sender);
+                } else {
+                    requestBlockBodies(sender);
+                }
             }
             break;
         }
@@ -285,7 +371,12 @@ void P2PNode::handleMessage(const Message& message, const std::string& sender) {
             
             // 构建可连接的节点列表
             json peersArray = json::array();
-            for (const auto& [nodeId, socket] : connections_) {
+            std::map<std::string, std::shared_ptr<tcp::socket>> connections;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex_);
+                connections = connections_;
+            }
+            for (const auto& [nodeId, socket] : connections) {
                 // 解析节点ID
                 size_t colonPos = nodeId.find(':');
                 if (colonPos == std::string::npos) continue;
@@ -395,17 +486,32 @@ void P2PNode::handleMessage(const Message& message, const std::string& sender) {
         case MessageType::SYNC_RESPONSE: {
             json syncData = json::parse(message.data);
             
-            // 处理区块数据
-            for (const auto& blockData : syncData["blocks"]) {
-                Block block(blockData);
-                blockchain_->addBlock(block.getTransactions(), false);
+            // 处理区块数据：并行验证，按顺序接到链尾
+            if (syncData.contains("blocks")) {
+                block_validator_.process(syncData["blocks"]);
             }
             
-            // 处理UTXO数据
-            if (syncData.contains("utxos")) {
-                for (const auto& utxoData : syncData["utxos"]) {
-                    UTXO utxo(utxoData);
-                    blockchain_->updateUTXO(utxo);
+            // 处理UTXO数据：上面的区块接入后，用本节点自己在该高度的承诺校验快照，
+            // 对端声明的承诺只用来提前拒绝，校验通过后整体替换UTXO池而不是合并
+            if (syncData.contains("utxos") && !syncData["utxos"].empty()) {
+                bool hasCommitment = syncData.contains("node_state") &&
+                                     syncData["node_state"].contains("height") &&
+                                     syncData["node_state"].contains("utxo_commitment");
+                bool snapshotValid = false;
+                if (hasCommitment) {
+                    int height = syncData["node_state"]["height"].get<int>() - 1;
+                    std::string localCommitment = blockchain_->getUTXOCommitmentAtHeight(height);
+                    if (!localCommitment.empty() && localCommitment == syncData["node_state"]["utxo_commitment"]) {
+                        std::vector<UTXO> utxos;
+                        for (const auto& utxoData : syncData["utxos"]) {
+                            utxos.push_back(UTXO(utxoData));
+                        }
+                        snapshotValid = blockchain_->replaceUTXOSet(utxos, height);
+                    }
+                }
+                if (!snapshotValid) {
+                    std::cout << "Rejected UTXO snapshot from: " << sender
+                              << (hasCommitment ? "" : " (no commitment)") << std::endl;
                 }
             }
             
@@ -437,8 +543,8 @@ void P2PNode::handleMessage(const Message& message, const std::string& sender) {
             if (success) {
                 // 验证新区块
                 Block newBlock(miningData["block"]);
-                if (blockchain_->verifyBlock(newBlock)) {
-                    blockchain_->addBlock(newBlock.getTransactions(), false);
+                // 接入收到的这个区块本身，而不是用它的交易重新出块
+                if (blockchain_->acceptBlock(newBlock)) {
                     // 广播新区块
                     Message msg;
                     msg.type = MessageType::NEW_BLOCK;
@@ -458,6 +564,32 @@ void P2PNode::handleMessage(const Message& message, const std::string& sender) {
             handleConsensusResult(message, sender);
             break;
         }
+        
+        case MessageType::GET_HEADERS: {
+            handleHeadersRequest(message, sender);
+            break;
+        }
+        
+        case MessageType::HEADERS: {
+            handleHeaders(message, sender);
+            break;
+        }
+        
+        case MessageType::GET_BLOCK_DATA: {
+            handleBlockDataRequest(message, sender);
+            break;
+        }
+        
+        case MessageType::REJECT: {
+            json reject = json::parse(message.data);
+            std::cout << "  " << host_ << ":" << port_ << " Request " << reject["request"].get<std::string>()
+                      << " rejected by " << sender << ": " << reject["reason"].get<std::string>() << std::endl;
+            // 对端是修剪节点时，可以改用区块头优先同步从其他节点下载区块体
+            if (reject["request"] == "GET_BLOCK_DATA") {
+                requestBlockBodiesElsewhere(sender);
+            }
+            break;
+        }
     }
 }
 
@@ -489,12 +621,26 @@ bool P2PNode::verifyMessage(const Message& message) {
     return result;
 }
 
-std::string P2PNode::serializeMessage(const Message& message) {
+std::string P2PNode::serializeMessage(const Message& message, bool compress) {
     json j;
     j["type"] = static_cast<int>(message.type);
     j["data"] = message.data;
     j["sender"] = message.sender;
     j["signature"] = message.signature;
+
+    // 签名针对原始 data，压缩只是传输编码；压缩后不更小就照常发送
+    if (compress) {
+        auto start = std::chrono::steady_clock::now();
+        std::string packed = Compression::compress(message.data);
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (packed.size() < message.data.size()) {
+            j["data"] = Compression::base64Encode(packed);
+            j["encoding"] = "lz4";
+            std::cout << "  " << host_ << ":" << port_ << " Compressed message type " << static_cast<int>(message.type)
+                      << ": " << message.data.size() << " -> " << packed.size() << " bytes (ratio "
+                      << static_cast<double>(message.data.size()) / packed.size() << ", " << elapsed << " ms)" << std::endl;
+        }
+    }
     return j.dump() + "\n";
 }
 
@@ -505,9 +651,34 @@ Message P2PNode::deserializeMessage(const std::string& data) {
     message.data = j["data"];
     message.sender = j["sender"];
     message.signature = j["signature"];
+
+    if (j.contains("encoding")) {
+        if (j["encoding"] != "lz4") {
+            throw std::runtime_error("unsupported message encoding");
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::string packed;
+        std::string raw;
+        if (!Compression::base64Decode(message.data, packed) || !Compression::decompress(packed, raw, Compression::MAX_MESSAGE_DECOMPRESSED_SIZE)) {
+            throw std::runtime_error("corrupt compressed message");
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << host_ << ":" << port_ << " Decompressed message: " << packed.size() << " -> "
+                  << raw.size() << " bytes";
+        if (elapsed > 0) {
+            std::cout << " (" << raw.size() / elapsed / (1024 * 1024) << " MiB/s)";
+        }
+        std::cout << std::endl;
+        message.data = std::move(raw);
+    }
     return message;
 }
 
+bool P2PNode::peerSupportsCompression(const std::string& nodeId) {
+    std::lock_guard<std::mutex> lock(compression_peers_mutex_);
+    return compression_peers_.count(nodeId) > 0;
+}
+
 void P2PNode::requestUTXOs(const std::string& address) {
     Message msg;
     msg.type = MessageType::GET_UTXOS;
@@ -529,12 +700,101 @@ void P2PNode::requestSync(int startHeight) {
     broadcastMessage(msg);
 }
 
+void P2PNode::requestHeaders() {
+    // locator：最佳区块头和链尾，对端从其中第一个已知的哈希之后开始返回
+    Message msg;
+    msg.type = MessageType::GET_HEADERS;
+    msg.sender = host_ + ":" + std::to_string(port_);
+    {
+        // 新一轮同步重新尝试所有节点
+        std::lock_guard<std::mutex> lock(inflight_bodies_mutex_);
+        body_refused_peers_.clear();
+    }
+    json locator = json::array();
+    locator.push_back(blockchain_->getBestHeader().hash);
+    locator.push_back(blockchain_->getLastHeader().hash);
+    msg.data = json({{"locator", locator}, {"max", MAX_HEADERS_PER_MESSAGE}}).dump();
+    broadcastMessage(msg);
+}
+
+void P2PNode::requestBlockBodies(const std::string& nodeId) {
+    std::vector<std::string> hashes;
+    {
+        std::lock_guard<std::mutex> lock(inflight_bodies_mutex_);
+        if (body_refused_peers_.find(nodeId) != body_refused_peers_.end()) {
+            return;
+        }
+        auto it = inflight_bodies_.find(nodeId);
+        if (it != inflight_bodies_.end() && !it->second.empty()) {
+            return;
+        }
+        // 跳过已经向其他节点请求的哈希，因此多取这么多个缺失的哈希
+        std::set<std::string> outstanding;
+        for (const auto& [peer, requested] : inflight_bodies_) {
+            outstanding.insert(requested.begin(), requested.end());
+        }
+        for (const auto& hash : blockchain_->getMissingBlockHashes(outstanding.size() + MAX_BLOCKS_PER_REQUEST)) {
+            if (hashes.size() >= MAX_BLOCKS_PER_REQUEST) {
+                break;
+            }
+            if (outstanding.find(hash) == outstanding.end()) {
+                hashes.push_back(hash);
+            }
+        }
+        if (hashes.empty()) {
+            return;
+        }
+        inflight_bodies_[nodeId].insert(hashes.begin(), hashes.end());
+    }
+    std::cout << "  " << host_ << ":" << port_ << " Requesting " << hashes.size() << " block bodies from: " << nodeId << std::endl;
+    Message msg;
+    msg.type = MessageType::GET_BLOCK_DATA;
+    msg.sender = host_ + ":" + std::to_string(port_);
+    msg.data = json({{"hashes", hashes}}).dump();
+    sendToNode(nodeId, msg);
+}
+
+size_t P2PNode::releaseBlockBodies(const std::string& nodeId) {
+    std::lock_guard<std::mutex> lock(inflight_bodies_mutex_);
+    auto it = inflight_bodies_.find(nodeId);
+    if (it == inflight_bodies_.end()) {
+        return 0;
+    }
+    size_t released = it->second.size();
+    inflight_bodies_.erase(it);
+    return released;
+}
+
+void P2PNode::requestBlockBodiesElsewhere(const std::string& refusedNodeId) {
+    std::vector<std::string> candidates;
+    {
+        std::lock_guard<std::mutex> lock(inflight_bodies_mutex_);
+        body_refused_peers_.insert(refusedNodeId);
+        inflight_bodies_.erase(refusedNodeId);
+        for (const auto& nodeId : getConnectedNodes()) {
+            if (body_refused_peers_.find(nodeId) == body_refused_peers_.end()) {
+                candidates.push_back(nodeId);
+            }
+        }
+    }
+    if (candidates.empty()) {
+        std::cout << "  " << host_ << ":" << port_ << " No connected node can serve the missing block bodies" << std::endl;
+        return;
+    }
+    std::cout << "  " << host_ << ":" << port_ << " " << refusedNodeId << " cannot serve block bodies, trying "
+              << candidates.size() << " other node(s)" << std::endl;
+    // 每个节点各拿一批不重叠的缺失区块体
+    for (const auto& nodeId : candidates) {
+        requestBlockBodies(nodeId);
+    }
+}
+
 void P2PNode::requestMining(const std::vector<Transaction>& transactions) {
     Message msg;
     msg.type = MessageType::MINING_REQUEST;
     json txArray = json::array();
     for (const auto& tx : transactions) {
-        txArray.push_back(json::parse(tx.toJson()));
+        txArray.push_back(tx.toJsonObject());
     }
     msg.data = txArray.dump();
     broadcastMessage(msg);
@@ -548,7 +808,7 @@ void P2PNode::broadcastConsensusVote(const Block& block, bool vote) {
     json voteData = {
         {"block_hash", block.getHash()},
         {"vote", vote},
-        {"block", json::parse(block.toJson())},  // 添加完整的区块数据
+        {"block", block.toJsonObject()},  // 添加完整的区块数据
         {"voterId", host_ + ":" + std::to_string(port_)}  // 添加投票者ID
     };
     
@@ -577,7 +837,7 @@ void P2PNode::broadcastConsensusResult(const Block& block, bool accepted) {
     json resultData = {
         {"block_hash", block.getHash()},
         {"accepted", accepted},
-        {"block", json::parse(block.toJson())},  // 添加完整的区块数据
+        {"block", block.toJsonObject()},  // 添加完整的区块数据
         {"voterId", host_ + ":" + std::to_string(port_)}  // 添加投票者ID
     };
     
@@ -624,32 +884,40 @@ void P2PNode::handleSyncRequest(const Message& message, const std::string& sende
     int startHeight = request["start_height"];
     bool includeUtxos = request["include_utxos"];
     bool includePendingTxs = request["include_pending_txs"];
+    if (rejectIfPruned(sender, "SYNC_REQUEST", startHeight)) {
+        return;
+    }
     
     // 构建同步响应
     Message response;
     response.type = MessageType::SYNC_RESPONSE;
     
+    // 需要UTXO数据时，UTXO集合和快照一起读取，响应里的承诺与UTXO集合一致
+    std::shared_ptr<const ChainSnapshot> snapshot;
+    std::vector<UTXO> utxos;
+    if (includeUtxos) {
+        utxos = blockchain_->getUTXOSnapshot(snapshot);
+    } else {
+        snapshot = blockchain_->getSnapshot();
+    }
     json syncData = {
         {"blocks", json::array()},
         {"utxos", json::array()},
         {"pending_transactions", json::array()},
         {"node_state", {
-            {"height", blockchain_->getChain().size()},
+            {"height", snapshot->getBlockCount()},
             {"difficulty", blockchain_->getDifficulty()},
             {"version", "1.0"},
-            {"last_block_hash", blockchain_->getLastBlock()->getHash()}
+            {"last_block_hash", snapshot->getTip().hash},
+            {"utxo_commitment", snapshot->getUTXOCommitment(snapshot->getBlockCount() - 1)}
         }}
     };
     
-    // 添加区块数据
-    auto blocks = blockchain_->getBlocksFromHeight(startHeight);
-    for (const auto& block : blocks) {
-        syncData["blocks"].push_back(json::parse(block.toJson()));
-    }
+    // 区块数据先以 BLOCKS 消息分块发送（同一连接上按顺序到达），响应本身不再携带区块
+    sendBlocksFrom(sender, startHeight);
     
     // 如果需要UTXO数据
     if (includeUtxos) {
-        auto utxos = blockchain_->getAllUTXOs();
         for (const auto& utxo : utxos) {
             syncData["utxos"].push_back(json::parse(utxo.toJson()));
         }
@@ -659,7 +927,7 @@ void P2PNode::handleSyncRequest(const Message& message, const std::string& sende
     if (includePendingTxs) {
         auto pendingTxs = blockchain_->getPendingTransactions();
         for (const auto& tx : pendingTxs) {
-            syncData["pending_transactions"].push_back(json::parse(tx.toJson()));
+            syncData["pending_transactions"].push_back(tx.toJsonObject());
         }
     }
     
@@ -679,10 +947,16 @@ void P2PNode::handleMiningRequest(const Message& message, const std::string& sen
     // 创建新区块
     blockchain_->addBlock(transactions, true);
     
+    auto lastBlock = blockchain_->getLastBlock();
+    if (!lastBlock) {
+        std::cout << "  " << host_ << ":" << port_ << " Mined block body is not available" << std::endl;
+        return;
+    }
+    
     // 构建响应
     Message response;
     response.type = MessageType::MINING_RESPONSE;
-    response.data = blockchain_->getChain().back()->toJson();
+    response.data = lastBlock->toJson();
     
     sendToNode(sender, response);
 }
@@ -792,11 +1066,10 @@ void P2PNode::handleConsensusResult(const Message& message, const std::string& s
             // 创建新区块
             Block newBlock(resultData["block"]);
         
-            // 验证区块
-            if (!blockchain_->verifyBlock(newBlock)) {
+            // 验证并接入区块；交易池中被确认的交易随之移除
+            if (!blockchain_->acceptBlock(newBlock)) {
                 std::cout << "Block verification failed: " << blockHash << std::endl;
             }else{
-                blockchain_->addBlock(newBlock.getTransactions(), false);// 添加到区块链
                 std::cout << "New block added to chain after consensus: " << blockHash << std::endl;
             }
         }         
@@ -811,6 +1084,147 @@ void P2PNode::handleConsensusResult(const Message& message, const std::string& s
     voted_nodes_.erase(blockHash);
 }
 
+void P2PNode::handleHeadersRequest(const Message& message, const std::string& sender) {
+    json request = json::parse(message.data);
+    std::vector<std::string> locator = request["locator"].get<std::vector<std::string>>();
+    size_t maxHeaders = std::min<size_t>(request.value("max", MAX_HEADERS_PER_MESSAGE), MAX_HEADERS_PER_MESSAGE);
+    
+    auto headers = blockchain_->getHeadersAfter(locator, maxHeaders);
+    json headersArray = json::array();
+    for (const auto& header : headers) {
+        headersArray.push_back(json::parse(header.toJson()));
+    }
+    
+    Message response;
+    response.type = MessageType::HEADERS;
+    response.sender = host_ + ":" + std::to_string(port_);
+    response.data = json({{"headers", headersArray}, {"height", blockchain_->getBlockCount()}}).dump();
+    sendToNode(sender, response);
+}
+
+void P2PNode::handleHeaders(const Message& message, const std::string& sender) {
+    json headersData = json::parse(message.data);
+    std::vector<BlockHeader> headers;
+    for (const auto& headerJson : headersData["headers"]) {
+        headers.push_back(BlockHeader(headerJson));
+    }
+    std::cout << "  " << host_ << ":" << port_ << " Received " << headers.size() << " headers from: " << sender << std::endl;
+    
+    // 先只验证区块头，链接或工作量证明不对就不下载任何区块体
+    if (!blockchain_->acceptHeaders(headers)) {
+        std::cout << "Rejected headers from: " << sender << std::endl;
+        return;
+    }
+    
+    // 一批满了说明对端还有更多区块头
+    if (headers.size() >= MAX_HEADERS_PER_MESSAGE) {
+        Message msg;
+        msg.type = MessageType::GET_HEADERS;
+        msg.sender = host_ + ":" + std::to_string(port_);
+        msg.data = json({{"locator", {blockchain_->getBestHeader().hash}}, {"max", MAX_HEADERS_PER_MESSAGE}}).dump();
+        sendToNode(sender, msg);
+    }
+    
+    requestBlockBodies(sender);
+}
+
+// 逐个区块写入 JSON 数组文本，不构造整个数组的 JSON 对象
+static std::string serializeBlockChunk(const Blockchain::BlockChunk& chunk) {
+    std::string data = "[";
+    for (size_t i = 0; i < chunk.size(); ++i) {
+        if (i > 0) {
+            data += ",";
+        }
+        data += chunk[i]->toJsonObject().dump();
+    }
+    data += "]";
+    return data;
+}
+
+bool P2PNode::rejectIfPruned(const std::string& nodeId, const std::string& request, int startHeight) {
+    int pruneHeight = blockchain_->getPruneHeight();
+    if (startHeight >= pruneHeight) {
+        return false;
+    }
+    std::cout << "  " << host_ << ":" << port_ << " Rejecting " << request << " from " << nodeId
+              << ": blocks below " << pruneHeight << " are pruned" << std::endl;
+    Message reject;
+    reject.type = MessageType::REJECT;
+    reject.sender = host_ + ":" + std::to_string(port_);
+    reject.data = json{
+        {"request", request},
+        {"reason", "pruned"},
+        {"start_height", startHeight},
+        {"prune_height", pruneHeight}
+    }.dump();
+    sendToNode(nodeId, reject);
+    return true;
+}
+
+size_t P2PNode::sendBlocksFrom(const std::string& nodeId, int startHeight) {
+    size_t sent = 0;
+    blockchain_->forEachBlockChunk(startHeight, BLOCKS_PER_CHUNK, [&](const Blockchain::BlockChunk& chunk) {
+        Message response;
+        response.type = MessageType::BLOCKS;
+        response.sender = host_ + ":" + std::to_string(port_);
+        response.data = serializeBlockChunk(chunk);
+        sendToNode(nodeId, response);
+        sent += chunk.size();
+        // 发送失败时连接已被移除，不再继续
+        return findConnection(nodeId) != nullptr;
+    });
+    std::cout << "  " << host_ << ":" << port_ << " Sent " << sent << " blocks from height "
+              << startHeight << " to: " << nodeId << std::endl;
+    return sent;
+}
+
+void P2PNode::handleBlockDataRequest(const Message& message, const std::string& sender) {
+    json request = json::parse(message.data);
+    json blocksArray = json::array();
+    json prunedHashes = json::array();
+    int pruneHeight = blockchain_->getPruneHeight();
+    size_t count = 0;
+    for (const auto& hash : request["hashes"]) {
+        if (count++ >= MAX_BLOCKS_PER_REQUEST) {
+            break;
+        }
+        auto block = findBlockByHash(hash);
+        if (block) {
+            blocksArray.push_back(block->toJsonObject());
+            continue;
+        }
+        int height = blockchain_->getHeightByHash(hash);
+        if (height >= 0 && height < pruneHeight) {
+            prunedHashes.push_back(hash);
+        }
+    }
+    
+    // 区块头仍然提供，但修剪掉的区块体明确拒绝，请求方会改向其他节点下载
+    if (!prunedHashes.empty()) {
+        std::cout << "  " << host_ << ":" << port_ << " Rejecting " << prunedHashes.size()
+                  << " pruned block bodies requested by " << sender << std::endl;
+        Message reject;
+        reject.type = MessageType::REJECT;
+        reject.sender = host_ + ":" + std::to_string(port_);
+        reject.data = json{
+            {"request", "GET_BLOCK_DATA"},
+            {"reason", "pruned"},
+            {"hashes", prunedHashes},
+            {"prune_height", pruneHeight}
+        }.dump();
+        sendToNode(sender, reject);
+        if (blocksArray.empty()) {
+            return;
+        }
+    }
+    
+    Message response;
+    response.type = MessageType::BLOCKS;
+    response.sender = host_ + ":" + std::to_string(port_);
+    response.data = blocksArray.dump();
+    sendToNode(sender, response);
+}
+
 void P2PNode::startIPC() {
     // 创建命名管道
     std::string pipe_name = "\\\\.\\pipe\\blockchain_node_" + host_ + "_" + std::to_string(port_);
@@ -921,27 +1335,17 @@ void P2PNode::updateNodeState(const json& state) {
 }
 
 std::shared_ptr<Block> P2PNode::findBlockByHash(const std::string& blockHash) const {
-    // 从区块链中查找区块
-    auto chain = blockchain_->getChain();
-    for (const auto& block : chain) {
-        if (block->getHash() == blockHash) {
-            return block;
-        }
-    }
-    return nullptr;
+    // 通过区块链的哈希索引查找区块
+    return blockchain_->getBlockByHash(blockHash);
 }
 
 std::shared_ptr<Block> P2PNode::findBlockByHeight(int height) const {
-    // 从区块链中查找指定高度的区块
-    auto chain = blockchain_->getChain();
-    if (height >= 0 && height < chain.size()) {
-        return chain[height];
-    }
-    return nullptr;
+    return blockchain_->getBlockByHeight(height);
 }
 
 
 int P2PNode::getMinConsensusNodes() const {
     // 根据节点数量计算最小共识节点数
+    std::lock_guard<std::mutex> lock(connections_mutex_);
     return static_cast<int>(connections_.size() * 0.5) + 1;
 }
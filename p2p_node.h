@@ -12,6 +12,8 @@
 #include <set>
 #include <boost/asio.hpp>
 #include "blockchain.h"
+#include "blockvalidator.h"
+#include "txingestor.h"
 #include "transaction.h"
 #include <unordered_set>
 #include <nlohmann/json.hpp>
@@ -36,7 +38,11 @@ enum class MessageType {
     MINING_REQUEST,     // 挖矿请求
     MINING_RESPONSE,    // 挖矿响应
     CONSENSUS_VOTE,     // 共识投票
-    CONSENSUS_RESULT    // 共识结果
+    CONSENSUS_RESULT,   // 共识结果
+    GET_HEADERS,        // 请求区块头（区块头优先同步）
+    HEADERS,            // 区块头数据
+    GET_BLOCK_DATA,     // 按哈希请求区块体
+    REJECT              // 拒绝请求（例如请求的区块已被修剪）
 };
 
 // 消息结构
@@ -64,11 +70,15 @@ public:
     void sendToNode(const std::string& nodeId, const Message& message);
     // 获取所有连接的节点
     std::vector<std::string> getConnectedNodes() const;
+    // 收到的交易在接收流水线中的处理统计
+    TxIngestStats getTxIngestStats() const;
 
     // 新增的区块链网络操作方法
     void requestUTXOs(const std::string& address);
     void requestBalance(const std::string& address);
     void requestSync(int startHeight);
+    // 区块头优先同步：先下载并验证区块头，再按需下载区块体
+    void requestHeaders();
     void requestMining(const std::vector<Transaction>& transactions);
     void broadcastConsensusVote(const Block& block, bool vote);
     void broadcastConsensusResult(const Block& block, bool accepted);
@@ -81,19 +91,26 @@ public:
 private:
 
     const float CONSENSUS_THRESHOLD = 0.5f;
+    const size_t MAX_HEADERS_PER_MESSAGE = 2000;   // 每条 HEADERS 消息最多携带的区块头
+    const size_t MAX_BLOCKS_PER_REQUEST = 16;      // 每次 GET_BLOCK_DATA 请求的区块体数量
+    const size_t BLOCKS_PER_CHUNK = 64;            // 服务同步时每条 BLOCKS 消息携带的区块数
 
     // 处理新连接
     void handleNewConnection();
+    // 在 connections_ 中查找节点的连接，找不到时返回空指针
+    std::shared_ptr<tcp::socket> findConnection(const std::string& nodeId) const;
     // 处理消息
     void handleMessage(const Message& message, const std::string& sender);
     // 消息处理循环
     void messageLoop();
     // 验证消息
     bool verifyMessage(const Message& message);
-    // 序列化消息
-    std::string serializeMessage(const Message& message);
-    // 反序列化消息
+    // 序列化消息，compress 为 true 时 data 以 LZ4 压缩并 base64 编码后发送
+    std::string serializeMessage(const Message& message, bool compress = false);
+    // 反序列化消息，自动解压压缩过的 data，数据损坏时抛出异常
     Message deserializeMessage(const std::string& data);
+    // 对端在握手中声明了支持 LZ4 压缩
+    bool peerSupportsCompression(const std::string& nodeId);
 
     // 新增的消息处理方法
     void handleUTXOsRequest(const Message& message, const std::string& sender);
@@ -102,6 +119,19 @@ private:
     void handleMiningRequest(const Message& message, const std::string& sender);
     void handleConsensusVote(const Message& message, const std::string& sender);
     void handleConsensusResult(const Message& message, const std::string& sender);
+    void handleHeadersRequest(const Message& message, const std::string& sender);
+    void handleHeaders(const Message& message, const std::string& sender);
+    void handleBlockDataRequest(const Message& message, const std::string& sender);
+    // 向指定节点请求下一批缺失且没有在途请求的区块体；该节点上一批还没回复时不发送
+    void requestBlockBodies(const std::string& nodeId);
+    // 对端回复或断开后释放它的在途请求，这些区块体可以重新向任意节点请求；返回释放的哈希数
+    size_t releaseBlockBodies(const std::string& nodeId);
+    // 对端无法提供区块体时不再向它请求，改向其他已连接的节点请求
+    void requestBlockBodiesElsewhere(const std::string& refusedNodeId);
+    // 请求的区块范围已被修剪时回复 REJECT 并返回 true
+    bool rejectIfPruned(const std::string& nodeId, const std::string& request, int startHeight);
+    // 从 startHeight 开始把区块分块发送给指定节点（每块一条 BLOCKS 消息），返回发送的区块数
+    size_t sendBlocksFrom(const std::string& nodeId, int startHeight);
     // IPC相关成员
     std::atomic<bool> exit_requested_{false};
     std::thread ipc_thread_;
@@ -112,9 +142,15 @@ private:
     std::string host_;
     int port_;
     std::shared_ptr<Blockchain> blockchain_;
+    ThreadPool validation_pool_;        // 同步时并行验证区块的线程池
+    BlockValidator block_validator_;
+    TxIngestor tx_ingestor_;            // 收到的交易经由它批量验证后进入交易池，不占用消息线程
     boost::asio::io_context io_context_;
     tcp::acceptor acceptor_;
     std::map<std::string, std::shared_ptr<tcp::socket>> connections_;
+    // connections_ 会被 IO 线程、消息线程和交易接收流水线的广播同时访问，读写都要持有该锁；
+    // 发送在锁外进行，持锁期间只查找或修改映射
+    mutable std::mutex connections_mutex_;
     std::queue<Message> message_queue_;
     std::mutex queue_mutex_;
     std::condition_variable queue_cv_;  // 添加条件变量声明
@@ -144,6 +180,17 @@ private:
     std::mutex node_state_mutex_;
     
     std::mutex consensus_mutex_;
+
+    // 在握手中声明可以解压 LZ4 消息的节点
+    std::set<std::string> compression_peers_;
+    std::mutex compression_peers_mutex_;
+    // data 超过该长度才压缩（同步和 BLOCKS 这类大消息）
+    static const size_t COMPRESSION_THRESHOLD = 4096;
+    // 区块头优先同步中已请求、对端还没回复的区块体（节点 -> 区块哈希），同一哈希只向一个节点请求
+    std::map<std::string, std::set<std::string>> inflight_bodies_;
+    // 本轮同步中回复 REJECT 或空 BLOCKS 的节点（例如修剪节点），不再向它们请求区块体
+    std::set<std::string> body_refused_peers_;
+    std::mutex inflight_bodies_mutex_;
     std::map<std::string, std::pair<int, int>> consensus_votes_;  // blockHash -> (赞成票数, 反对票数)
     std::map<std::string, bool> voted_blocks_;  // blockHash -> 是否已投票
     std::map<std::string, std::set<std::string>> voted_nodes_;  // blockHash -> 已投票的节点列表
@@ -0,0 +1,150 @@
+// UTXO集合并发压力测试：一个写者连续应用区块，多个读者同时查询。
+// 写者的每个区块花费已有的UTXO并把金额拆给两个地址，总额保持不变。
+// 读者并发执行 findUTXO / getBalance / getUTXOsForAddress / selectUTXOs，检查读到的数据不越界；
+// 结束后检查总额守恒、UTXO数量与承诺一致。
+// 用法：utxo_stress_test [区块数] [读线程数]
+#include "utxo.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int ADDRESS_COUNT = 32;
+static const int TRANSFERS_PER_BLOCK = 20;
+static const double COINS_PER_ADDRESS = 1000.0;
+
+int main(int argc, char* argv[]) {
+    int blockCount = argc > 1 ? std::stoi(argv[1]) : 200;
+    int readerCount = argc > 2 ? std::stoi(argv[2]) : 4;
+
+    // 交易和UTXO池的调试输出太多，测试期间关闭
+    std::cout.setstate(std::ios::failbit);
+
+    std::vector<std::string> addresses;
+    for (int i = 0; i < ADDRESS_COUNT; ++i) {
+        addresses.push_back("addr" + std::to_string(i));
+    }
+
+    UTXOPool pool;
+    std::vector<Transaction> genesis;
+    for (int i = 0; i < ADDRESS_COUNT; ++i) {
+        genesis.push_back(Transaction::createSystemTransaction(addresses[i], COINS_PER_ADDRESS));
+    }
+    pool.applyTransactions(genesis);
+    const double totalSupply = COINS_PER_ADDRESS * ADDRESS_COUNT;
+
+    // 写者自己记录未花费的输出；读者只读它发布过的输出点（可能已被花费）
+    std::vector<UTXO> live;
+    for (const auto& tx : genesis) {
+        live.push_back(UTXO(tx.getTransactionId(), 0, tx.getOutputs()[0].getAmount(), tx.getTo()));
+    }
+    const size_t maxPublished = static_cast<size_t>(blockCount) * TRANSFERS_PER_BLOCK * 2 + live.size();
+    std::vector<std::pair<std::string, int>> published(maxPublished);
+    std::atomic<size_t> publishedCount{0};
+    for (const auto& utxo : live) {
+        published[publishedCount++] = {utxo.getTxId(), utxo.getOutputIndex()};
+    }
+
+    std::atomic<bool> writing{true};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> failures{0};
+    auto fail = [&](const std::string& message) {
+        if (failures++ < 10) {
+            std::cerr << "FAIL: " << message << std::endl;
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < readerCount; ++r) {
+        readers.emplace_back([&, r]() {
+            std::mt19937 rng(r + 1);
+            while (writing) {
+                const std::string& address = addresses[rng() % ADDRESS_COUNT];
+                double balance = pool.getBalance(address);
+                if (balance < -1e-6 || balance > totalSupply + 1e-6) {
+                    fail("balance out of range for " + address + ": " + std::to_string(balance));
+                }
+                for (const auto& utxo : pool.getUTXOsForAddress(address)) {
+                    if (utxo.getOwner() != address || utxo.getAmount() <= 0) {
+                        fail("bad UTXO in address index of " + address);
+                    }
+                }
+                for (const auto& utxo : pool.selectUTXOs(address, balance / 2)) {
+                    if (utxo.getOwner() != address) {
+                        fail("selected UTXO of another owner for " + address);
+                    }
+                }
+                size_t count = publishedCount.load();
+                const auto& outpoint = published[rng() % count];
+                UTXO found;
+                if (pool.findUTXO(outpoint.first, outpoint.second, found) &&
+                    (found.getTxId() != outpoint.first || found.getOutputIndex() != outpoint.second)) {
+                    fail("findUTXO returned a different outpoint");
+                }
+                reads += 4;
+            }
+        });
+    }
+
+    std::mt19937 rng(12345);
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < blockCount; ++b) {
+        std::vector<Transaction> block;
+        std::vector<UTXO> created;
+        for (int t = 0; t < TRANSFERS_PER_BLOCK && !live.empty(); ++t) {
+            size_t pick = rng() % live.size();
+            UTXO spent = live[pick];
+            live[pick] = live.back();
+            live.pop_back();
+
+            const std::string& to = addresses[rng() % ADDRESS_COUNT];
+            double first = spent.getAmount() / 2;
+            Transaction tx(spent.getOwner(), to, spent.getAmount());
+            tx.addInput(TransactionInput(spent.getTxId(), spent.getOutputIndex(), ""));
+            tx.addOutput(TransactionOutput(first, to));
+            tx.addOutput(TransactionOutput(spent.getAmount() - first, spent.getOwner()));
+            for (size_t i = 0; i < tx.getOutputs().size(); ++i) {
+                const auto& output = tx.getOutputs()[i];
+                created.push_back(UTXO(tx.getTransactionId(), static_cast<int>(i), output.getAmount(), output.getOwner()));
+            }
+            block.push_back(tx);
+        }
+        pool.applyTransactions(block);
+        for (const auto& utxo : created) {
+            live.push_back(utxo);
+            published[publishedCount.load()] = {utxo.getTxId(), utxo.getOutputIndex()};
+            publishedCount++;
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    writing = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    // 写者停止后的一致性检查
+    double total = 0.0;
+    for (const auto& address : addresses) {
+        total += pool.getBalance(address);
+    }
+    if (std::abs(total - totalSupply) > 1e-6) {
+        fail("total supply changed: " + std::to_string(total));
+    }
+    auto all = pool.getAllUTXOs();
+    if (all.size() != live.size()) {
+        fail("UTXO count " + std::to_string(all.size()) + " != expected " + std::to_string(live.size()));
+    }
+    if (pool.getCommitment() != UTXOPool::computeCommitment(all)) {
+        fail("rolling commitment does not match the UTXO set");
+    }
+
+    std::cout.clear();
+    std::cout << "utxo_stress_test: " << blockCount << " blocks applied in " << elapsed << " s alongside "
+              << readerCount << " readers (" << reads.load() << " reads), " << all.size() << " UTXOs, "
+              << failures.load() << " failures" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
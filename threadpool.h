@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+// 固定大小的线程池，用于并行验证等CPU密集型任务
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = 0);  // 0 表示使用CPU核心数
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 提交一个任务，返回可以等待结果的 future
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    // 把 [0, count) 的迭代分给线程池执行并等待全部完成。
+    // 调用线程自己也参与执行，所以在池内线程中嵌套调用也不会死锁。
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    size_t size() const { return workers_.size(); }
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_;
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+};
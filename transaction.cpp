@@ -22,12 +22,13 @@ TransactionOutput::TransactionOutput(double amount, const std::string& owner)
 {
 }
 
-Transaction::Transaction(const std::string& from, const std::string& to, double amount)
+Transaction::Transaction(const std::string& from, const std::string& to, double amount, double fee)
     : from_(from)
     , to_(to)
     , amount_(amount)
+    , fee_(fee)
 {
-    std::cout << "Transaction::Transaction: " << from_ << " " << to_ << " " << amount_ << std::endl;
+    std::cout << "Transaction::Transaction: " << from_ << " " << to_ << " " << amount_ << " fee " << fee_ << std::endl;
     transactionId_ = calculateTransactionId();
 }
 
@@ -39,6 +40,25 @@ Transaction Transaction::createSystemTransaction(const std::string& to, double a
     return tx;
 }
 
+Transaction Transaction::createFeeTransaction(const std::string& miner, double fees, double outputFees,
+                                              int height, int position) {
+    Transaction tx("SYSTEM", miner, fees);
+    tx.signature_ = "SYSTEM_SIGNATURE_" + std::to_string(fees) + "_" + miner;
+    tx.addInput(TransactionInput(feeInputTxId(height), position, ""));
+    if (outputFees > 0.0) {
+        tx.addOutput(TransactionOutput(outputFees, miner));
+    }
+    return tx;
+}
+
+std::string Transaction::feeInputTxId(int height) {
+    return "FEES_" + std::to_string(height);
+}
+
+bool Transaction::isFeeTransaction() const {
+    return from_ == "SYSTEM" && inputs_.size() == 1 && inputs_[0].getTxId().rfind("FEES_", 0) == 0;
+}
+
 void Transaction::addInput(const TransactionInput& input) {
     std::cout << "Transaction::addInput: " << transactionId_ << " input: " << input.getTxId() << " " << input.getOutputIndex() << std::endl;
     inputs_.push_back(input);
@@ -66,6 +86,10 @@ bool Transaction::verifySignature() const {
 std::string Transaction::calculateTransactionId() const {
     std::stringstream ss;
     ss << from_ << to_ << amount_;
+    // 没有手续费的交易保持原来的ID
+    if (fee_ != 0.0) {
+        ss << "fee" << fee_;
+    }
     
     // 添加输入和输出的信息
     for (const auto& input : inputs_) {
@@ -93,14 +117,22 @@ std::string Transaction::calculateTransactionId() const {
 
 // 检查交易是否有效（包括余额检查）
 bool Transaction::isValid() const {
-    return !from_.empty() && !to_.empty() && amount_ > 0 && !signature_.empty();
+    return !from_.empty() && !to_.empty() && amount_ > 0 && fee_ >= 0 && !signature_.empty();
 }
 
 std::string Transaction::toJson() const {
+    return toJsonObject().dump();
+}
+
+json Transaction::toJsonObject() const {
     json j;
     j["from"] = from_;
     j["to"] = to_;
     j["amount"] = amount_;
+    // 只在有手续费时输出，旧区块的序列化结果（以及交易索引里的偏移）不变
+    if (fee_ != 0.0) {
+        j["fee"] = fee_;
+    }
     j["timestamp"] = timestamp_;
     j["transactionId"] = transactionId_;
     j["signature"] = signature_;
@@ -126,13 +158,14 @@ std::string Transaction::toJson() const {
     }
     j["outputs"] = outputs;
     
-    return j.dump();
+    return j;
 }
 
 Transaction::Transaction(const json& json) {
     from_ = json["from"];
     to_ = json["to"];
     amount_ = json["amount"];
+    fee_ = json.value("fee", 0.0);
     timestamp_ = json["timestamp"];
     transactionId_ = json["transactionId"];
     signature_ = json["signature"];
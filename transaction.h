@@ -36,20 +36,22 @@ private:
 class Transaction {
 public:
     Transaction() : amount_(0.0) {}  // 添加默认构造函数
-    Transaction(const std::string& from, const std::string& to, double amount);
+    // fee 为付给出块者的手续费，出块时按手续费率排序打包；为 0 时交易ID与旧版本相同
+    Transaction(const std::string& from, const std::string& to, double amount, double fee = 0.0);
     Transaction(const nlohmann::json& json);  // 添加从 JSON 构造的构造函数
     
     // Getters
     const std::string& getFrom() const { return from_; }
     const std::string& getTo() const { return to_; }
     double getAmount() const { return amount_; }
+    double getFee() const { return fee_; }
     const std::string& getTimestamp() const { return timestamp_; }
     const std::string& getTransactionId() const { return transactionId_; }
     const std::string& getSignature() const { return signature_; }
     bool isValid() const;
     bool hasEnoughBalance(double balance) const {
-        std::cout << "Checking balance: " << balance << " >= " << amount_ << std::endl;
-        return balance >= amount_;
+        std::cout << "Checking balance: " << balance << " >= " << amount_ + fee_ << std::endl;
+        return balance >= amount_ + fee_;
     }
    
     // 验证交易签名
@@ -60,6 +62,17 @@ public:
 
     // 创建系统交易（用于初始余额分配）
     static Transaction createSystemTransaction(const std::string& to, double amount);
+    // 把区块中交易的手续费付给出块者的系统交易。amount 为全部手续费，其中输入/输出交易的手续费
+    // outputFees 作为输出进入UTXO集合，其余（普通交易的手续费）和普通交易的金额一样只记入余额变更。
+    // 唯一的输入只用区块高度和在区块中的位置区分不同的手续费交易，不花费任何输出
+    static Transaction createFeeTransaction(const std::string& miner, double fees, double outputFees,
+                                            int height, int position);
+    // 手续费交易的输入引用的交易ID，只标记区块高度
+    static std::string feeInputTxId(int height);
+    // 是否为 createFeeTransaction 生成的手续费交易（区块中最多一笔，且必须在最后）
+    bool isFeeTransaction() const;
+    // 金额是 double，比较输入与输出的合计时允许的误差
+    static constexpr double AMOUNT_EPSILON = 1e-9;
 
     void addInput(const TransactionInput& input);
     void addOutput(const TransactionOutput& output);
@@ -68,11 +81,14 @@ public:
 
     // 将交易转换为 JSON 字符串
     std::string toJson() const;
+    // JSON 对象形式，拼装更大的消息时不必先序列化再解析
+    nlohmann::json toJsonObject() const;
 
 private:
     std::string from_;          // 发送方公钥
     std::string to_;            // 接收方公钥
     double amount_;             // 交易金额
+    double fee_ = 0.0;          // 手续费
     std::string timestamp_;     // 交易时间戳
     std::string transactionId_; // 交易ID（哈希值）
     std::string signature_;     // 交易签名
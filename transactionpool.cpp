@@ -1,86 +1,503 @@
 #include "transactionpool.h"
 #include <algorithm>
+#include <unordered_set>
 
-TransactionPool::TransactionPool() {
+// 输出点的索引键
+static std::string outpointKey(const std::string& txId, int outputIndex) {
+    return txId + ":" + std::to_string(outputIndex);
+}
+
+// 红黑树节点（颜色+三个指针）与哈希表节点（next 指针+缓存的哈希值+桶指针）的额外开销
+static const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+static const size_t HASH_NODE_OVERHEAD = 3 * sizeof(void*);
+
+// 字符串在堆上的分配，短字符串存放在对象内部不另外分配
+static size_t heapBytes(const std::string& s) {
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+// 估算一个条目在内存中的占用：交易本身、entries_ 的节点，以及它在各个索引中的节点
+static size_t estimateMemoryUsage(const PoolEntry& entry) {
+    const Transaction& tx = entry.transaction;
+    const std::string& txId = tx.getTransactionId();
+
+    size_t usage = MAP_NODE_OVERHEAD + sizeof(std::pair<const std::string, PoolEntry>) + heapBytes(txId);
+    usage += heapBytes(tx.getFrom()) + heapBytes(tx.getTo()) + heapBytes(tx.getTimestamp())
+           + heapBytes(txId) + heapBytes(tx.getSignature());
+    usage += tx.getInputs().capacity() * sizeof(TransactionInput);
+    for (const auto& input : tx.getInputs()) {
+        usage += heapBytes(input.getTxId()) + heapBytes(input.getSignature());
+    }
+    usage += tx.getOutputs().capacity() * sizeof(TransactionOutput);
+    for (const auto& output : tx.getOutputs()) {
+        usage += heapBytes(output.getOwner());
+    }
+
+    // 地址索引、发送方索引和按序号排列的索引中各有一个 (序号 -> txId) 节点
+    size_t sequenceNode = MAP_NODE_OVERHEAD + sizeof(std::pair<const uint64_t, std::string>) + heapBytes(txId);
+    usage += (AddressIndex::addressesOf(tx).size() + 2) * sequenceNode;
+    usage += MAP_NODE_OVERHEAD + sizeof(std::pair<double, uint64_t>);
+    // 每个输入在输出点表中有一个节点
+    for (const auto& input : tx.getInputs()) {
+        usage += HASH_NODE_OVERHEAD + sizeof(std::pair<const std::string, std::string>)
+               + heapBytes(outpointKey(input.getTxId(), input.getOutputIndex())) + heapBytes(txId);
+    }
+    return usage;
+}
+
+TransactionPool::TransactionPool()
+    : nextSequence_(1)
+{
 }
 
 bool TransactionPool::addTransaction(const Transaction& transaction, const UTXOPool& utxoPool) {
     std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId() << std::endl;
+    // 签名等无状态检查不需要持有锁
+    if (!checkTransaction(transaction)) {
+        std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId() << " invalid" << std::endl;
+        return false;
+    }
     std::lock_guard<std::mutex> lock(mutex_);
-    
+    expireLocked(std::chrono::steady_clock::now());
+    return insertLocked(transaction, utxoPool);
+}
+
+std::vector<bool> TransactionPool::addCheckedTransactions(const std::vector<Transaction>& transactions,
+                                                          const UTXOPool& utxoPool) {
+    std::vector<bool> added;
+    added.reserve(transactions.size());
+    std::lock_guard<std::mutex> lock(mutex_);
+    expireLocked(std::chrono::steady_clock::now());
+    for (const auto& transaction : transactions) {
+        added.push_back(insertLocked(transaction, utxoPool));
+    }
+    return added;
+}
+
+bool TransactionPool::insertLocked(const Transaction& transaction, const UTXOPool& utxoPool) {
     // 检查交易是否已经在池中
-    if (transactions_.find(transaction.getTransactionId()) != transactions_.end()) {
+    if (entries_.find(transaction.getTransactionId()) != entries_.end()) {
         std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId() << " already in pool" << std::endl;
         return false;
     }
     
-    // 验证交易
-    if (!isValidTransaction(transaction, utxoPool)) {
-        std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId() << " invalid" << std::endl;
+    // 与池中交易花费同一输出的视为双花，先到先得
+    auto conflicts = findConflictsLocked(transaction);
+    if (!conflicts.empty()) {
+        std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId()
+                  << " conflicts with " << conflicts.front() << std::endl;
+        return false;
+    }
+    
+    if (!inputsCoverOutputsLocked(transaction, utxoPool)) {
+        return false;
+    }
+    
+    // 余额还要扣掉该发送方在池中已承诺的金额，否则多笔交易可以合计超支
+    auto pending = pendingSpend_.find(transaction.getFrom());
+    double committed = pending == pendingSpend_.end() ? 0.0 : pending->second;
+    double credit = unconfirmedCreditLocked(transaction);
+    if (!utxoPool.hasEnoughFunds(transaction.getFrom(), transaction.getAmount() + transaction.getFee() + committed - credit)) {
+        std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId()
+                  << " not enough funds with " << committed << " pending" << std::endl;
+        return false;
+    }
+    
+    // 池满时按策略腾出空间，新交易优先级不够就拒绝
+    PoolEntry entry{transaction, nextSequence_, transaction.toJson().size(), std::chrono::steady_clock::now()};
+    entry.memoryUsage = estimateMemoryUsage(entry);
+    if (entry.memoryUsage > policy_.maxMemoryBytes || !makeRoomLocked(entry.memoryUsage, &entry)) {
+        std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId()
+                  << " rejected, pool full (" << memoryUsage_ << "/" << policy_.maxMemoryBytes << " bytes)" << std::endl;
         return false;
     }
     
     // 添加到交易池
-    transactions_[transaction.getTransactionId()] = transaction;
+    nextSequence_++;
+    indexTransaction(entry);
+    entries_.emplace(transaction.getTransactionId(), std::move(entry));
     std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId() << " added to pool" << std::endl;
     return true;
 }
 
-void TransactionPool::removeTransaction(const std::string& txId) {
+bool TransactionPool::resolveInputLocked(const TransactionInput& input, const UTXOPool& utxoPool, UTXO& output) const {
+    if (utxoPool.findUTXO(input.getTxId(), input.getOutputIndex(), output)) {
+        return true;
+    }
+    auto parent = entries_.find(input.getTxId());
+    if (parent == entries_.end()) {
+        return false;
+    }
+    const auto& outputs = parent->second.transaction.getOutputs();
+    if (input.getOutputIndex() < 0 || static_cast<size_t>(input.getOutputIndex()) >= outputs.size()) {
+        return false;
+    }
+    const auto& spent = outputs[input.getOutputIndex()];
+    output = UTXO(input.getTxId(), input.getOutputIndex(), spent.getAmount(), spent.getOwner());
+    return true;
+}
+
+bool TransactionPool::inputsCoverOutputsLocked(const Transaction& transaction, const UTXOPool& utxoPool) const {
+    if (transaction.getInputs().empty() && transaction.getOutputs().empty()) {
+        return true;
+    }
+    double inputTotal = 0.0;
+    for (const auto& input : transaction.getInputs()) {
+        UTXO spent;
+        if (!resolveInputLocked(input, utxoPool, spent)) {
+            std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId() << " missing input "
+                      << input.getTxId() << ":" << input.getOutputIndex() << std::endl;
+            return false;
+        }
+        inputTotal += spent.getAmount();
+    }
+    double outputTotal = 0.0;
+    for (const auto& output : transaction.getOutputs()) {
+        outputTotal += output.getAmount();
+    }
+    // 差额就是手续费，输入不够时手续费会凭空产生
+    if (inputTotal + Transaction::AMOUNT_EPSILON < outputTotal + transaction.getFee()) {
+        std::cout << "TransactionPool::addTransaction: " << transaction.getTransactionId() << " inputs " << inputTotal
+                  << " do not cover outputs " << outputTotal << " and fee " << transaction.getFee() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+double TransactionPool::unconfirmedCreditLocked(const Transaction& transaction) const {
+    double credit = 0.0;
+    for (const auto& input : transaction.getInputs()) {
+        auto parent = entries_.find(input.getTxId());
+        if (parent == entries_.end() || parent->second.transaction.getFrom() == transaction.getFrom()) {
+            continue;
+        }
+        const auto& outputs = parent->second.transaction.getOutputs();
+        if (input.getOutputIndex() >= 0 && static_cast<size_t>(input.getOutputIndex()) < outputs.size()) {
+            const auto& output = outputs[input.getOutputIndex()];
+            if (output.getOwner() == transaction.getFrom()) {
+                credit += output.getAmount();
+            }
+        }
+    }
+    return credit;
+}
+
+size_t TransactionPool::removeTransaction(const std::string& txId) {
     std::cout << "TransactionPool::removeTransaction: " << txId << std::endl;
     std::lock_guard<std::mutex> lock(mutex_);
-    transactions_.erase(txId);
+    return removeWithDescendantsLocked(txId);
+}
+
+size_t TransactionPool::removeForBlock(const std::vector<Transaction>& confirmed, const UTXOPool& utxoPool) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t confirmedCount = 0;
+    std::unordered_set<std::string> affectedSenders;
+
+    // 被确认的交易本身；它们的子交易引用的输出现在已在UTXO池中，继续保留
+    for (const auto& tx : confirmed) {
+        auto it = entries_.find(tx.getTransactionId());
+        if (it != entries_.end()) {
+            unindexTransaction(it->second);
+            entries_.erase(it);
+            confirmedCount++;
+        }
+        if (tx.getFrom() != "SYSTEM") {
+            affectedSenders.insert(tx.getFrom());
+        }
+    }
+
+    // 区块已经花费的输出，池中仍花费它们的交易是双花
+    size_t invalidated = 0;
+    for (const auto& tx : confirmed) {
+        for (const auto& input : tx.getInputs()) {
+            auto spent = spentOutpoints_.find(outpointKey(input.getTxId(), input.getOutputIndex()));
+            if (spent != spentOutpoints_.end()) {
+                invalidated += removeWithDescendantsLocked(std::string(spent->second));
+            }
+        }
+    }
+
+    // 发送方的余额被区块改变，按进入顺序累计，放不下的交易移除
+    for (const auto& sender : affectedSenders) {
+        auto pending = senderIndex_.find(sender);
+        if (pending == senderIndex_.end()) {
+            continue;
+        }
+        double balance = utxoPool.getBalance(sender);
+        double committed = 0.0;
+        std::vector<std::string> unfunded;
+        for (const auto& [sequence, txId] : pending->second) {
+            const Transaction& tx = entries_.at(txId).transaction;
+            double cost = tx.getAmount() + tx.getFee() - unconfirmedCreditLocked(tx);
+            if (balance >= committed + cost) {
+                committed += cost;
+            } else {
+                unfunded.push_back(txId);
+            }
+        }
+        for (const auto& txId : unfunded) {
+            invalidated += removeWithDescendantsLocked(txId);
+        }
+    }
+
+    invalidated_ += invalidated;
+    std::cout << "TransactionPool::removeForBlock: " << confirmedCount << " confirmed, " << invalidated
+              << " invalidated, " << entries_.size() << " remain" << std::endl;
+    return confirmedCount + invalidated;
 }
 
 std::vector<Transaction> TransactionPool::getTransactions() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    std::cout << "TransactionPool::getTransactions: " << transactions_.size() << std::endl;
+    std::cout << "TransactionPool::getTransactions: " << entries_.size() << std::endl;
     std::vector<Transaction> result;
-    result.reserve(transactions_.size());
+    result.reserve(entries_.size());
     
-    for (const auto& pair : transactions_) {
-        result.push_back(pair.second);
+    for (const auto& pair : entries_) {
+        result.push_back(pair.second.transaction);
     }
     
     return result;
 }
 
+std::vector<PoolEntry> TransactionPool::getEntries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PoolEntry> result;
+    result.reserve(entries_.size());
+    for (const auto& pair : entries_) {
+        result.push_back(pair.second);
+    }
+    return result;
+}
+
 size_t TransactionPool::size() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return transactions_.size();
+    return entries_.size();
 }
 
 void TransactionPool::clear() {
     std::lock_guard<std::mutex> lock(mutex_);
-    transactions_.clear();
+    entries_.clear();
+    addressIndex_.clear();
+    senderIndex_.clear();
+    pendingSpend_.clear();
+    spentOutpoints_.clear();
+    bySequence_.clear();
+    byFeeRate_.clear();
+    memoryUsage_ = 0;
+}
+
+void TransactionPool::setPolicy(const TransactionPoolPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policy_ = policy;
+    std::cout << "TransactionPool: limited to " << policy.maxMemoryBytes << " bytes, evicting by "
+              << (policy.eviction == TransactionPoolPolicy::Eviction::FeeRate ? "fee rate" : "age")
+              << ", expiry " << policy.expirySeconds << "s" << std::endl;
+    makeRoomLocked(0, nullptr);
+    expireLocked(std::chrono::steady_clock::now());
+}
+
+size_t TransactionPool::expireStale() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return expireLocked(std::chrono::steady_clock::now());
+}
+
+size_t TransactionPool::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memoryUsage_;
+}
+
+TransactionPoolStats TransactionPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TransactionPoolStats stats;
+    stats.transactions = entries_.size();
+    stats.memoryUsage = memoryUsage_;
+    stats.maxMemoryBytes = policy_.maxMemoryBytes;
+    stats.evicted = evicted_;
+    stats.expired = expired_;
+    stats.rejectedFull = rejectedFull_;
+    stats.invalidated = invalidated_;
+    return stats;
+}
+
+size_t TransactionPool::removeWithDescendantsLocked(const std::string& txId) {
+    size_t removed = 0;
+    std::vector<std::string> pending{txId};
+    while (!pending.empty()) {
+        std::string id = std::move(pending.back());
+        pending.pop_back();
+        auto it = entries_.find(id);
+        if (it == entries_.end()) {
+            continue;
+        }
+        // 花费这笔交易输出的子交易失去了资金来源，一并移除
+        for (size_t i = 0; i < it->second.transaction.getOutputs().size(); ++i) {
+            auto child = spentOutpoints_.find(outpointKey(id, static_cast<int>(i)));
+            if (child != spentOutpoints_.end()) {
+                pending.push_back(child->second);
+            }
+        }
+        unindexTransaction(it->second);
+        entries_.erase(it);
+        removed++;
+    }
+    return removed;
+}
+
+std::vector<std::string> TransactionPool::descendantsLocked(const std::string& txId) const {
+    std::vector<std::string> result;
+    std::unordered_set<std::string> visited{txId};
+    std::vector<std::string> pending{txId};
+    while (!pending.empty()) {
+        std::string id = std::move(pending.back());
+        pending.pop_back();
+        auto it = entries_.find(id);
+        if (it == entries_.end()) {
+            continue;
+        }
+        for (size_t i = 0; i < it->second.transaction.getOutputs().size(); ++i) {
+            auto child = spentOutpoints_.find(outpointKey(id, static_cast<int>(i)));
+            if (child != spentOutpoints_.end() && visited.insert(child->second).second) {
+                pending.push_back(child->second);
+            }
+        }
+        result.push_back(std::move(id));
+    }
+    return result;
+}
+
+size_t TransactionPool::expireLocked(std::chrono::steady_clock::time_point now) {
+    if (policy_.expirySeconds == 0) {
+        return 0;
+    }
+    // 序号与进入时间同序，只需要从最早的开始检查
+    size_t removed = 0;
+    const auto expiry = std::chrono::seconds(policy_.expirySeconds);
+    while (!bySequence_.empty()) {
+        const PoolEntry& oldest = entries_.at(bySequence_.begin()->second);
+        if (now - oldest.entryTime < expiry) {
+            break;
+        }
+        removed += removeWithDescendantsLocked(oldest.transaction.getTransactionId());
+    }
+    if (removed > 0) {
+        expired_ += removed;
+        std::cout << "TransactionPool: expired " << removed << " transactions" << std::endl;
+    }
+    return removed;
+}
+
+bool TransactionPool::makeRoomLocked(size_t required, const PoolEntry* incoming) {
+    if (memoryUsage_ + required <= policy_.maxMemoryBytes) {
+        return true;
+    }
+    const size_t excess = memoryUsage_ + required - policy_.maxMemoryBytes;
+
+    // 新交易依赖的父交易不能被淘汰
+    std::unordered_set<std::string> parents;
+    if (incoming) {
+        for (const auto& input : incoming->transaction.getInputs()) {
+            parents.insert(input.getTxId());
+        }
+    }
+
+    // 先选出要淘汰的条目，确认能腾出足够空间后再真正移除。
+    // 淘汰一个条目会连带移除它的后代，所以按整组判断能否淘汰，并按整组计算腾出的空间
+    const bool byFeeRate = policy_.eviction == TransactionPoolPolicy::Eviction::FeeRate;
+    std::vector<std::string> victims;
+    std::unordered_set<std::string> selected;
+    size_t freed = 0;
+    auto consider = [&](uint64_t sequence) {
+        const std::string& txId = bySequence_.at(sequence);
+        if (selected.count(txId) != 0) {
+            return true;
+        }
+        auto package = descendantsLocked(txId);
+        for (const auto& id : package) {
+            if (parents.count(id) != 0) {
+                return true;
+            }
+            if (byFeeRate && incoming && selected.count(id) == 0 &&
+                entries_.at(id).getFeeRate() >= incoming->getFeeRate()) {
+                return true;
+            }
+        }
+        victims.push_back(txId);
+        for (const auto& id : package) {
+            if (selected.insert(id).second) {
+                freed += entries_.at(id).memoryUsage;
+            }
+        }
+        return freed < excess;
+    };
+    if (byFeeRate) {
+        for (const auto& [feeRate, sequence] : byFeeRate_) {
+            if (incoming && feeRate >= incoming->getFeeRate()) {
+                break;
+            }
+            if (!consider(sequence)) {
+                break;
+            }
+        }
+    } else {
+        for (const auto& [sequence, txId] : bySequence_) {
+            if (!consider(sequence)) {
+                break;
+            }
+        }
+    }
+    if (freed < excess) {
+        if (incoming) {
+            rejectedFull_++;
+        }
+        return false;
+    }
+
+    size_t removed = 0;
+    for (const auto& txId : victims) {
+        removed += removeWithDescendantsLocked(txId);
+    }
+    evicted_ += removed;
+    std::cout << "TransactionPool: evicted " << removed << " transactions, " << memoryUsage_ << "/"
+              << policy_.maxMemoryBytes << " bytes in use" << std::endl;
+    return true;
 }
 
 bool TransactionPool::isValidTransaction(const Transaction& transaction, const UTXOPool& utxoPool) const {
-    // 验证签名
-    if (!transaction.verifySignature()) {
-        std::cout << "TransactionPool::isValidTransaction: " << transaction.getTransactionId() << " signature invalid" << std::endl;
+    if (!checkTransaction(transaction)) {
         return false;
     }
-    
-    // 验证发送者有足够的余额
-    if (!utxoPool.hasEnoughFunds(transaction.getFrom(), transaction.getAmount())) {
-        std::cout << "TransactionPool::isValidTransaction: " << transaction.getTransactionId() << " has enough funds" << std::endl;
+    // 验证发送者有足够的余额（含手续费）
+    if (!utxoPool.hasEnoughFunds(transaction.getFrom(), transaction.getAmount() + transaction.getFee())) {
+        std::cout << "TransactionPool::isValidTransaction: " << transaction.getTransactionId() << " not enough funds" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TransactionPool::checkTransaction(const Transaction& transaction) {
+    // 验证签名
+    if (!transaction.verifySignature()) {
+        std::cout << "TransactionPool::checkTransaction: " << transaction.getTransactionId() << " signature invalid" << std::endl;
         return false;
     }
     
     // 验证交易金额大于0
     if (transaction.getAmount() <= 0) {
-        std::cout << "TransactionPool::isValidTransaction: " << transaction.getTransactionId() << " amount <= 0" << std::endl;
+        std::cout << "TransactionPool::checkTransaction: " << transaction.getTransactionId() << " amount <= 0" << std::endl;
+        return false;
+    }
+    if (transaction.getFee() < 0) {
+        std::cout << "TransactionPool::checkTransaction: " << transaction.getTransactionId() << " fee < 0" << std::endl;
         return false;
     }
     
     // 验证发送者和接收者不是同一个地址
     if (transaction.getFrom() == transaction.getTo()) {
-        std::cout << "TransactionPool::isValidTransaction: " << transaction.getTransactionId() << " from == to" << std::endl;
+        std::cout << "TransactionPool::checkTransaction: " << transaction.getTransactionId() << " from == to" << std::endl;
         return false;
     }
     
-    std::cout << "TransactionPool::isValidTransaction: " << transaction.getTransactionId() << " valid" << std::endl;
+    std::cout << "TransactionPool::checkTransaction: " << transaction.getTransactionId() << " valid" << std::endl;
     return true;
 }
 
@@ -88,12 +505,120 @@ std::vector<Transaction> TransactionPool::getTransactionsForAddress(const std::s
     std::lock_guard<std::mutex> lock(mutex_);
     std::vector<Transaction> result;
     
-    for (const auto& pair : transactions_) {
-        const Transaction& tx = pair.second;
-        if (tx.getFrom() == address || tx.getTo() == address) {
-            result.push_back(tx);
-        }
+    auto it = addressIndex_.find(address);
+    if (it == addressIndex_.end()) {
+        return result;
+    }
+    for (const auto& [sequence, txId] : it->second) {
+        result.push_back(entries_.at(txId).transaction);
     }
     
     return result;
-} 
\ No newline at end of file
+}
+
+std::vector<AddressHistoryEntry> TransactionPool::getPendingHistory(const std::string& address, uint64_t afterSequence,
+                                                                    size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<AddressHistoryEntry> result;
+    auto it = addressIndex_.find(address);
+    if (it == addressIndex_.end()) {
+        return result;
+    }
+    for (auto entry = it->second.upper_bound(afterSequence);
+         entry != it->second.end() && result.size() < limit; ++entry) {
+        result.push_back({entry->second, -1, entry->first});
+    }
+    return result;
+}
+
+std::vector<Transaction> TransactionPool::getTransactionsFromSender(const std::string& sender) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Transaction> result;
+    auto it = senderIndex_.find(sender);
+    if (it == senderIndex_.end()) {
+        return result;
+    }
+    result.reserve(it->second.size());
+    for (const auto& [sequence, txId] : it->second) {
+        result.push_back(entries_.at(txId).transaction);
+    }
+    return result;
+}
+
+double TransactionPool::getPendingSpend(const std::string& sender) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pendingSpend_.find(sender);
+    return it == pendingSpend_.end() ? 0.0 : it->second;
+}
+
+std::vector<std::string> TransactionPool::findConflicts(const Transaction& transaction) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return findConflictsLocked(transaction);
+}
+
+bool TransactionPool::isOutpointSpent(const std::string& txId, int outputIndex) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spentOutpoints_.count(outpointKey(txId, outputIndex)) > 0;
+}
+
+std::vector<std::string> TransactionPool::findConflictsLocked(const Transaction& transaction) const {
+    std::vector<std::string> result;
+    for (const auto& input : transaction.getInputs()) {
+        auto it = spentOutpoints_.find(outpointKey(input.getTxId(), input.getOutputIndex()));
+        if (it != spentOutpoints_.end() && it->second != transaction.getTransactionId() &&
+            std::find(result.begin(), result.end(), it->second) == result.end()) {
+            result.push_back(it->second);
+        }
+    }
+    return result;
+}
+
+void TransactionPool::indexTransaction(const PoolEntry& entry) {
+    const Transaction& tx = entry.transaction;
+    for (const auto& address : AddressIndex::addressesOf(tx)) {
+        addressIndex_[address][entry.sequence] = tx.getTransactionId();
+    }
+    senderIndex_[tx.getFrom()][entry.sequence] = tx.getTransactionId();
+    bySequence_[entry.sequence] = tx.getTransactionId();
+    byFeeRate_.insert({entry.getFeeRate(), entry.sequence});
+    memoryUsage_ += entry.memoryUsage;
+    pendingSpend_[tx.getFrom()] += tx.getAmount() + tx.getFee();
+    for (const auto& input : tx.getInputs()) {
+        spentOutpoints_[outpointKey(input.getTxId(), input.getOutputIndex())] = tx.getTransactionId();
+    }
+}
+
+void TransactionPool::unindexTransaction(const PoolEntry& entry) {
+    for (const auto& address : AddressIndex::addressesOf(entry.transaction)) {
+        auto entries = addressIndex_.find(address);
+        if (entries == addressIndex_.end()) {
+            continue;
+        }
+        entries->second.erase(entry.sequence);
+        if (entries->second.empty()) {
+            addressIndex_.erase(entries);
+        }
+    }
+
+    const Transaction& tx = entry.transaction;
+    bySequence_.erase(entry.sequence);
+    byFeeRate_.erase({entry.getFeeRate(), entry.sequence});
+    memoryUsage_ -= entry.memoryUsage;
+    auto sender = senderIndex_.find(tx.getFrom());
+    if (sender != senderIndex_.end()) {
+        sender->second.erase(entry.sequence);
+        if (sender->second.empty()) {
+            // 发送方最后一笔交易离开时整体删除，避免浮点累计误差残留
+            senderIndex_.erase(sender);
+            pendingSpend_.erase(tx.getFrom());
+        } else {
+            pendingSpend_[tx.getFrom()] -= tx.getAmount() + tx.getFee();
+        }
+    }
+    for (const auto& input : tx.getInputs()) {
+        auto spent = spentOutpoints_.find(outpointKey(input.getTxId(), input.getOutputIndex()));
+        if (spent != spentOutpoints_.end() && spent->second == tx.getTransactionId()) {
+            spentOutpoints_.erase(spent);
+        }
+    }
+}
@@ -2,23 +2,81 @@
 
 #include "transaction.h"
 #include "utxo.h"
+#include "addressindex.h"
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <chrono>
+
+// 交易池条目：交易及其进入交易池时记录的元数据
+struct PoolEntry {
+    Transaction transaction;
+    uint64_t sequence;                                // 进入交易池的序号，越小越早
+    size_t size;                                      // 序列化后的字节数
+    std::chrono::steady_clock::time_point entryTime;  // 进入交易池的时间
+    size_t memoryUsage = 0;                           // 在内存中占用的字节数（交易、元数据及各索引）
+
+    // 每字节手续费
+    double getFeeRate() const { return size == 0 ? 0.0 : transaction.getFee() / size; }
+};
+
+// 交易池的内存上限与淘汰策略
+struct TransactionPoolPolicy {
+    enum class Eviction {
+        FeeRate,   // 先淘汰每字节手续费最低的；新交易的费率不高于它们时直接拒绝新交易
+        Age        // 先淘汰最早进入交易池的
+    };
+
+    size_t maxMemoryBytes = DEFAULT_MAX_MEMORY_BYTES;
+    Eviction eviction = Eviction::FeeRate;
+    // 在池中停留超过 expirySeconds 仍未被打包的交易被丢弃；0 表示不过期
+    unsigned expirySeconds = DEFAULT_EXPIRY_SECONDS;
+
+    static const size_t DEFAULT_MAX_MEMORY_BYTES = 300 * 1024 * 1024;
+    static const unsigned DEFAULT_EXPIRY_SECONDS = 14 * 24 * 3600;
+};
+
+struct TransactionPoolStats {
+    size_t transactions = 0;
+    size_t memoryUsage = 0;       // 当前占用的字节数
+    size_t maxMemoryBytes = 0;
+    uint64_t evicted = 0;         // 为腾出空间被淘汰的交易数（含依赖它们的子交易）
+    uint64_t expired = 0;         // 过期被丢弃的交易数
+    uint64_t rejectedFull = 0;    // 池满且优先级不够而被拒绝的交易数
+    uint64_t invalidated = 0;     // 区块接入后因冲突或余额不足被移除的交易数
+};
 
 class TransactionPool {
 public:
     TransactionPool();
     
+    // 设置内存上限与淘汰策略，上限变小时立即淘汰多出的交易
+    void setPolicy(const TransactionPoolPolicy& policy);
+    // 丢弃过期的交易，返回丢弃的数量；添加交易时也会顺便检查
+    size_t expireStale();
+    size_t getMemoryUsage() const;
+    TransactionPoolStats getStats() const;
+    
     // 添加交易到池中
     bool addTransaction(const Transaction& transaction, const UTXOPool& utxoPool);
+    // 批量添加已通过 checkTransaction 的交易：一次加锁，只做去重、冲突、余额检查和插入。
+    // 返回值与 transactions 一一对应
+    std::vector<bool> addCheckedTransactions(const std::vector<Transaction>& transactions, const UTXOPool& utxoPool);
     
-    // 从池中移除交易
-    void removeTransaction(const std::string& txId);
+    // 从池中移除交易及花费其输出的所有后代交易（后代失去了输入，不能留在池中）。返回移除的交易数
+    size_t removeTransaction(const std::string& txId);
+    // 区块接入后维护交易池（utxoPool 已应用该区块）：移除被确认的交易，移除与区块花费同一输出的交易
+    // 及其子交易，只对余额被区块改变的发送方按进入顺序重新检查余额。其余交易原样保留。返回移除的交易数
+    size_t removeForBlock(const std::vector<Transaction>& confirmed, const UTXOPool& utxoPool);
     
     // 获取池中的所有交易
     std::vector<Transaction> getTransactions() const;
+    // 获取池中所有交易及其元数据（用于组装区块模板）
+    std::vector<PoolEntry> getEntries() const;
     
     // 获取池中的交易数量
     size_t size() const;
@@ -28,11 +86,58 @@ public:
     
     // 验证交易是否有效
     bool isValidTransaction(const Transaction& transaction, const UTXOPool& utxoPool) const;
+    // 不依赖链状态和交易池的检查（签名、金额、手续费、收发地址），可以在任意线程并行调用
+    static bool checkTransaction(const Transaction& transaction);
     
     // 获取指定地址的所有待处理交易
     std::vector<Transaction> getTransactionsForAddress(const std::string& address) const;
+    // 指定地址在序号 afterSequence 之后进入交易池的最多 limit 笔交易，按进入顺序
+    std::vector<AddressHistoryEntry> getPendingHistory(const std::string& address, uint64_t afterSequence,
+                                                       size_t limit) const;
+    // 指定发送方的待处理交易，按进入交易池的顺序
+    std::vector<Transaction> getTransactionsFromSender(const std::string& sender) const;
+    // 发送方在池中已承诺但尚未确认的金额（含手续费）
+    double getPendingSpend(const std::string& sender) const;
+    // 池中与 transaction 花费同一输出的交易
+    std::vector<std::string> findConflicts(const Transaction& transaction) const;
+    // 输出是否已被池中某笔交易花费
+    bool isOutpointSpent(const std::string& txId, int outputIndex) const;
     
 private:
-    std::map<std::string, Transaction> transactions_; // txId -> Transaction
+    std::map<std::string, PoolEntry> entries_;        // txId -> 交易及元数据
+    std::unordered_map<std::string, std::map<uint64_t, std::string>> addressIndex_;  // 地址 -> (序号 -> txId)
+    std::unordered_map<std::string, std::map<uint64_t, std::string>> senderIndex_;   // 发送方 -> (序号 -> txId)
+    std::unordered_map<std::string, double> pendingSpend_;                         // 发送方 -> 池中已承诺金额
+    std::unordered_map<std::string, std::string> spentOutpoints_;                  // "txId:下标" -> 花费它的池中交易
+    std::map<uint64_t, std::string> bySequence_;         // 序号 -> txId，即进入交易池的先后（用于按时间淘汰和过期）
+    std::set<std::pair<double, uint64_t>> byFeeRate_;   // (费率, 序号)，最前面的最先被淘汰
+    uint64_t nextSequence_;
+    TransactionPoolPolicy policy_;
+    size_t memoryUsage_ = 0;
+    uint64_t evicted_ = 0;
+    uint64_t expired_ = 0;
+    uint64_t rejectedFull_ = 0;
+    uint64_t invalidated_ = 0;
     mutable std::mutex mutex_;
+    
+    void indexTransaction(const PoolEntry& entry);
+    void unindexTransaction(const PoolEntry& entry);
+    bool insertLocked(const Transaction& transaction, const UTXOPool& utxoPool);
+    std::vector<std::string> findConflictsLocked(const Transaction& transaction) const;
+    // 输入花费的输出：先在UTXO集合中找，再在池中父交易的输出中找
+    bool resolveInputLocked(const TransactionInput& input, const UTXOPool& utxoPool, UTXO& output) const;
+    // 输入/输出交易的输入都能找到，且合计不少于输出加手续费
+    bool inputsCoverOutputsLocked(const Transaction& transaction, const UTXOPool& utxoPool) const;
+    // 交易花费的、其他发送方的池中父交易付给本交易发送方的输出合计：还没确认，不在UTXO余额里，
+    // 但同样可以用来支付。发送方自己的父交易的找零不计入，已承诺金额只含父交易的金额和手续费，找零本来就还在余额里
+    double unconfirmedCreditLocked(const Transaction& transaction) const;
+    // 移除交易以及花费其输出的池中子交易，返回移除的数量
+    size_t removeWithDescendantsLocked(const std::string& txId);
+    // 交易本身以及花费其输出的所有池中后代交易，即 removeWithDescendantsLocked 会移除的条目
+    std::vector<std::string> descendantsLocked(const std::string& txId) const;
+    size_t expireLocked(std::chrono::steady_clock::time_point now);
+    // 淘汰条目直到再放入 required 字节也不超过上限。淘汰一个条目会连同它的后代一起移除，
+    // incoming 非空时这一组里不能有 incoming 依赖的父交易，按费率淘汰时也不能有费率不低于它的交易；
+    // 空间仍然不够则不做任何淘汰并返回 false
+    bool makeRoomLocked(size_t required, const PoolEntry* incoming);
 }; 
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "txindex.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+// 文件格式（每行一项）：
+//   T <txid> <height> <position> <byteOffset> <size>
+//   B <height>                      区块 height 的交易已全部写入
+static std::string formatTxLine(const std::string& txId, const TxLocation& location) {
+    std::stringstream ss;
+    ss << "T " << txId << " " << location.height << " " << location.position << " "
+       << location.byteOffset << " " << location.size << "\n";
+    return ss.str();
+}
+
+TxIndex::TxIndex(const std::string& path)
+    : path_(path)
+    , blockCount_(0)
+{
+}
+
+bool TxIndex::open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    locations_.clear();
+    blockCount_ = 0;
+    if (path_.empty()) {
+        return true;
+    }
+
+    std::ifstream in(path_);
+    std::string line;
+    std::vector<std::pair<std::string, TxLocation>> uncommitted;
+    bool complete = true;
+    while (std::getline(in, line)) {
+        // 没有换行符结尾的最后一行是写了一半的
+        if (in.eof()) {
+            complete = false;
+            break;
+        }
+        std::stringstream ss(line);
+        std::string kind;
+        ss >> kind;
+        if (kind == "T") {
+            std::string txId;
+            TxLocation location;
+            if (!(ss >> txId >> location.height >> location.position >> location.byteOffset >> location.size)) {
+                complete = false;
+                break;
+            }
+            uncommitted.push_back({txId, location});
+        } else if (kind == "B") {
+            int height;
+            if (!(ss >> height) || height != blockCount_) {
+                complete = false;
+                break;
+            }
+            for (const auto& [txId, location] : uncommitted) {
+                locations_[txId] = location;
+            }
+            uncommitted.clear();
+            blockCount_++;
+        } else {
+            complete = false;
+            break;
+        }
+    }
+    in.close();
+
+    if (!complete || !uncommitted.empty()) {
+        std::cout << "TxIndex::open: discarding incomplete tail of " << path_ << std::endl;
+        rewriteFile();
+    }
+    std::cout << "TxIndex::open: " << locations_.size() << " transactions in "
+              << blockCount_ << " blocks" << std::endl;
+    return true;
+}
+
+bool TxIndex::addBlock(const Block& block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (block.getIndex() != blockCount_) {
+        std::cout << "TxIndex::addBlock: out of order block " << block.getIndex() << std::endl;
+        return false;
+    }
+
+    // 交易在区块JSON中的序列化与单独序列化完全相同，按顺序查找即可得到偏移
+    std::string data = block.toJson();
+    std::string lines;
+    size_t searchFrom = 0;
+    const auto& transactions = block.getTransactions();
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        std::string txData = transactions[i].toJson();
+        size_t offset = data.find(txData, searchFrom);
+        if (offset == std::string::npos) {
+            offset = 0;
+        } else {
+            searchFrom = offset + txData.size();
+        }
+
+        TxLocation location;
+        location.height = block.getIndex();
+        location.position = static_cast<uint32_t>(i);
+        location.byteOffset = offset;
+        location.size = static_cast<uint32_t>(txData.size());
+        locations_[transactions[i].getTransactionId()] = location;
+        lines += formatTxLine(transactions[i].getTransactionId(), location);
+    }
+    lines += "B " + std::to_string(block.getIndex()) + "\n";
+    blockCount_++;
+
+    if (!path_.empty()) {
+        std::ofstream out(path_, std::ios::app);
+        out << lines;
+        out.flush();
+        if (!out) {
+            std::cout << "TxIndex::addBlock: failed to write " << path_ << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TxIndex::find(const std::string& txId, TxLocation& location) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = locations_.find(txId);
+    if (it == locations_.end()) {
+        return false;
+    }
+    location = it->second;
+    return true;
+}
+
+void TxIndex::truncate(int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (height >= blockCount_) {
+        return;
+    }
+    for (auto it = locations_.begin(); it != locations_.end();) {
+        if (it->second.height >= height) {
+            it = locations_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    blockCount_ = std::max(height, 0);
+    rewriteFile();
+}
+
+int TxIndex::getBlockCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blockCount_;
+}
+
+size_t TxIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return locations_.size();
+}
+
+void TxIndex::rewriteFile() {
+    if (path_.empty()) {
+        return;
+    }
+    // 按高度和下标排序后重写，保证每个区块的交易行都在它的区块标记之前
+    std::map<std::pair<int, uint32_t>, std::string> ordered;
+    for (const auto& [txId, location] : locations_) {
+        ordered[{location.height, location.position}] = formatTxLine(txId, location);
+    }
+    std::string raw;
+    int nextHeight = 0;
+    for (const auto& [key, line] : ordered) {
+        while (nextHeight < key.first) {
+            raw += "B " + std::to_string(nextHeight++) + "\n";
+        }
+        raw += line;
+    }
+    while (nextHeight < blockCount_) {
+        raw += "B " + std::to_string(nextHeight++) + "\n";
+    }
+    std::ofstream out(path_, std::ios::trunc);
+    out << raw;
+}
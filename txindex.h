@@ -0,0 +1,41 @@
+#pragma once
+
+#include "block.h"
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+// 交易在链上的位置
+struct TxLocation {
+    int height;            // 所在区块高度
+    uint32_t position;     // 在区块交易列表中的下标
+    uint64_t byteOffset;   // 交易JSON在（未压缩的）区块JSON中的字节偏移
+    uint32_t size;         // 交易JSON的长度
+};
+
+// 交易索引：txid -> 位置。
+// path 非空时以文本形式追加保存到文件，每个区块的交易行之后写一行区块标记，
+// 打开时丢弃最后一个区块标记之后的不完整内容
+class TxIndex {
+public:
+    TxIndex(const std::string& path = "");
+
+    bool open();
+    // 按高度顺序索引一个区块，高度必须等于 getBlockCount()
+    bool addBlock(const Block& block);
+    bool find(const std::string& txId, TxLocation& location) const;
+    // 丢弃指定高度及之后的区块的索引
+    void truncate(int height);
+
+    int getBlockCount() const;
+    size_t size() const;
+
+private:
+    std::string path_;
+    std::unordered_map<std::string, TxLocation> locations_;
+    int blockCount_;
+    mutable std::mutex mutex_;
+
+    void rewriteFile();
+};
@@ -0,0 +1,137 @@
+#include "txingestor.h"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <iostream>
+#include <optional>
+
+using json = nlohmann::json;
+
+TxIngestor::TxIngestor(Blockchain& blockchain, ThreadPool& pool, AcceptedCallback onAccepted,
+                       size_t batchSize, size_t maxQueued)
+    : blockchain_(blockchain)
+    , pool_(pool)
+    , onAccepted_(std::move(onAccepted))
+    , batchSize_(batchSize == 0 ? 1 : batchSize)
+    , maxQueued_(maxQueued)
+{
+}
+
+TxIngestor::~TxIngestor() {
+    stop();
+}
+
+void TxIngestor::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    dispatcher_ = std::thread(&TxIngestor::dispatchLoop, this);
+}
+
+void TxIngestor::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCv_.notify_one();
+    }
+    if (dispatcher_.joinable()) {
+        dispatcher_.join();
+    }
+}
+
+bool TxIngestor::submit(std::string payload, std::string sender) {
+    // 超过上限时丢弃，防止突发流量在验证跟不上时耗尽内存
+    if (queued_.fetch_add(1, std::memory_order_relaxed) >= maxQueued_) {
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    queue_.push(Item{std::move(payload), std::move(sender)});
+    received_.fetch_add(1, std::memory_order_relaxed);
+    if (sleeping_.load()) {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCv_.notify_one();
+    }
+    return true;
+}
+
+TxIngestStats TxIngestor::getStats() const {
+    TxIngestStats stats;
+    stats.received = received_.load();
+    stats.accepted = accepted_.load();
+    stats.rejected = rejected_.load();
+    stats.dropped = dropped_.load();
+    stats.queued = queued_.load();
+    return stats;
+}
+
+void TxIngestor::dispatchLoop() {
+    std::vector<Item> batch;
+    batch.reserve(batchSize_);
+    while (running_) {
+        Item item;
+        while (batch.size() < batchSize_ && queue_.pop(item)) {
+            batch.push_back(std::move(item));
+        }
+        if (!batch.empty()) {
+            queued_.fetch_sub(batch.size(), std::memory_order_relaxed);
+            processBatch(batch);
+            batch.clear();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        sleeping_ = true;
+        wakeCv_.wait_for(lock, std::chrono::milliseconds(IDLE_WAIT_MS),
+                         [this] { return !queue_.empty() || !running_; });
+        sleeping_ = false;
+    }
+}
+
+void TxIngestor::processBatch(std::vector<Item>& batch) {
+    auto start = std::chrono::steady_clock::now();
+
+    // 阶段1（并行）：反序列化和签名等无状态检查，不持有任何锁
+    std::vector<std::optional<Transaction>> checked(batch.size());
+    pool_.parallelFor(batch.size(), [&](size_t i) {
+        try {
+            Transaction tx(json::parse(batch[i].payload));
+            if (TransactionPool::checkTransaction(tx)) {
+                checked[i] = std::move(tx);
+            }
+        } catch (const std::exception& e) {
+            std::cout << "TxIngestor: failed to parse transaction from " << batch[i].sender << ": " << e.what() << std::endl;
+        }
+    });
+
+    std::vector<Transaction> candidates;
+    std::vector<size_t> origin;
+    candidates.reserve(batch.size());
+    for (size_t i = 0; i < checked.size(); ++i) {
+        if (checked[i]) {
+            candidates.push_back(std::move(*checked[i]));
+            origin.push_back(i);
+        }
+    }
+
+    // 阶段2（串行）：整批在交易池锁内插入，按到达顺序先到先得
+    std::vector<bool> added = blockchain_.addCheckedTransactionsToPool(candidates);
+    size_t acceptedCount = 0;
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        if (!added[k]) {
+            continue;
+        }
+        acceptedCount++;
+        if (onAccepted_) {
+            const Item& item = batch[origin[k]];
+            onAccepted_(candidates[k], item.payload, item.sender);
+        }
+    }
+    accepted_.fetch_add(acceptedCount, std::memory_order_relaxed);
+    rejected_.fetch_add(batch.size() - acceptedCount, std::memory_order_relaxed);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "TxIngestor: batch of " << batch.size() << ", " << acceptedCount << " accepted, "
+              << batch.size() - acceptedCount << " rejected in " << elapsed.count() << " ms" << std::endl;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "blockchain.h"
+#include "threadpool.h"
+#include "mpscqueue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct TxIngestStats {
+    uint64_t received = 0;   // 进入队列的交易数
+    uint64_t accepted = 0;   // 进入交易池的交易数
+    uint64_t rejected = 0;   // 解析失败、检查失败或交易池拒绝的交易数
+    uint64_t dropped = 0;    // 队列已满被丢弃的交易数
+    size_t queued = 0;       // 还在队列中等待的交易数
+};
+
+// 交易接收流水线：
+//   网络线程把交易 JSON 放进无锁的多生产者单消费者队列后立即返回
+//   调度线程成批取出，由线程池并行完成反序列化、签名和无状态检查
+//   通过检查的交易整批在交易池锁内做去重、冲突和余额检查并插入
+class TxIngestor {
+public:
+    // 交易进入交易池后在调度线程上回调，payload 是收到的原始 JSON
+    using AcceptedCallback = std::function<void(const Transaction& tx, const std::string& payload,
+                                                const std::string& sender)>;
+
+    TxIngestor(Blockchain& blockchain, ThreadPool& pool, AcceptedCallback onAccepted,
+               size_t batchSize = DEFAULT_BATCH_SIZE, size_t maxQueued = DEFAULT_MAX_QUEUED);
+    ~TxIngestor();
+
+    TxIngestor(const TxIngestor&) = delete;
+    TxIngestor& operator=(const TxIngestor&) = delete;
+
+    void start();
+    // 停止调度线程，队列中剩余的交易被丢弃
+    void stop();
+
+    // 可以在任意线程调用，不加锁；队列已满时丢弃并返回 false
+    bool submit(std::string payload, std::string sender);
+
+    TxIngestStats getStats() const;
+
+    static const size_t DEFAULT_BATCH_SIZE = 256;
+    static const size_t DEFAULT_MAX_QUEUED = 100000;
+
+private:
+    struct Item {
+        std::string payload;
+        std::string sender;
+    };
+
+    Blockchain& blockchain_;
+    ThreadPool& pool_;
+    AcceptedCallback onAccepted_;
+    const size_t batchSize_;
+    const size_t maxQueued_;
+
+    MPSCQueue<Item> queue_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::atomic<bool> running_{false};
+    std::thread dispatcher_;
+    // 只在调度线程空闲等待时使用；生产者仅在它睡眠时才加锁唤醒
+    std::atomic<bool> sleeping_{false};
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+
+    void dispatchLoop();
+    void processBatch(std::vector<Item>& batch);
+
+    // 错过唤醒时调度线程最多等待这么久再检查队列
+    static constexpr unsigned IDLE_WAIT_MS = 50;
+};
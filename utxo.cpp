@@ -1,5 +1,8 @@
 #include "utxo.h"
 #include <algorithm>
+#include <limits>
+#include <sstream>
+#include <iomanip>
 #include "nlohmann/json.hpp"
 
 using json = nlohmann::json;
@@ -24,45 +27,186 @@ UTXO::UTXO(const json& data) {
 UTXOPool::UTXOPool() {
 }
 
+UTXOPool::OutpointShard& UTXOPool::outpointShard(const std::string& txId) {
+    return outpointShards_[std::hash<std::string>{}(txId) % SHARD_COUNT];
+}
+
+const UTXOPool::OutpointShard& UTXOPool::outpointShard(const std::string& txId) const {
+    return outpointShards_[std::hash<std::string>{}(txId) % SHARD_COUNT];
+}
+
+UTXOPool::AddressShard& UTXOPool::addressShard(const std::string& owner) {
+    return addressShards_[std::hash<std::string>{}(owner) % SHARD_COUNT];
+}
+
+const UTXOPool::AddressShard& UTXOPool::addressShard(const std::string& owner) const {
+    return addressShards_[std::hash<std::string>{}(owner) % SHARD_COUNT];
+}
+
 void UTXOPool::addUTXO(const UTXO& utxo) {
-    std::cout << "      UTXOPool::addUTXO: " << utxo.getTxId() << ", " << utxo.getOutputIndex() << std::endl;
-    utxos_[utxo.getTxId()][utxo.getOutputIndex()] = utxo;
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    addUTXOLocked(utxo);
 }
 
 void UTXOPool::removeUTXO(const std::string& txId, int outputIndex) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    removeUTXOLocked(txId, outputIndex);
+}
+
+void UTXOPool::applyTransactions(const std::vector<Transaction>& transactions) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    for (const auto& tx : transactions) {
+        // 移除已使用的UTXO
+        for (const auto& input : tx.getInputs()) {
+            removeUTXOLocked(input.getTxId(), input.getOutputIndex());
+        }
+        // 添加新的UTXO
+        for (size_t i = 0; i < tx.getOutputs().size(); ++i) {
+            const auto& output = tx.getOutputs()[i];
+            addUTXOLocked(UTXO(tx.getTransactionId(), i, output.getAmount(), output.getOwner()));
+        }
+    }
+}
+
+void UTXOPool::replaceAll(const std::vector<UTXO>& utxos) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    for (auto& shard : outpointShards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.utxos.clear();
+    }
+    for (auto& shard : addressShards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.index.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(commitment_mutex_);
+        commitment_ = MuHash();
+    }
+    for (const auto& utxo : utxos) {
+        addUTXOLocked(utxo);
+    }
+}
+
+void UTXOPool::addUTXOLocked(const UTXO& utxo) {
+    std::cout << "      UTXOPool::addUTXO: " << utxo.getTxId() << ", " << utxo.getOutputIndex() << std::endl;
+    UTXO previous;
+    {
+        OutpointShard& shard = outpointShard(utxo.getTxId());
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        UTXO& slot = shard.utxos[utxo.getTxId()][utxo.getOutputIndex()];
+        previous = slot;
+        slot = utxo;
+    }
+    // 覆盖已有的UTXO时先把旧值从索引和承诺中移除
+    if (!previous.getTxId().empty()) {
+        unindexUTXO(previous);
+    }
+    indexUTXO(utxo);
+
+    std::lock_guard<std::mutex> lock(commitment_mutex_);
+    if (!previous.getTxId().empty()) {
+        commitment_.remove(commitmentKey(previous));
+    }
+    commitment_.insert(commitmentKey(utxo));
+}
+
+void UTXOPool::removeUTXOLocked(const std::string& txId, int outputIndex) {
     std::cout << "      removeUTXO: " << txId << ", " << outputIndex << std::endl;
-    auto txIt = utxos_.find(txId);
-    if (txIt != utxos_.end()) {
-        std::cout << "      removeUTXO: " << txId << ", " << outputIndex << " found" << std::endl;
+    UTXO removed;
+    if (!findUTXO(txId, outputIndex, removed)) {
+        return;
+    }
+    std::cout << "      removeUTXO: " << txId << ", " << outputIndex << " found" << std::endl;
+
+    // 先从地址索引中移除，保证索引里出现的UTXO总能在分片中找到
+    unindexUTXO(removed);
+    {
+        OutpointShard& shard = outpointShard(txId);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto txIt = shard.utxos.find(txId);
         txIt->second.erase(outputIndex);
         if (txIt->second.empty()) {
             std::cout << "      removeUTXO: " << txId << ", " << outputIndex << " erased" << std::endl;
-            utxos_.erase(txIt);
+            shard.utxos.erase(txIt);
         }
     }
+
+    std::lock_guard<std::mutex> lock(commitment_mutex_);
+    commitment_.remove(commitmentKey(removed));
 }
 
-std::vector<UTXO> UTXOPool::getUTXOsForAddress(const std::string& address) const {
+bool UTXOPool::findUTXO(const std::string& txId, int outputIndex, UTXO& utxo) const {
+    const OutpointShard& shard = outpointShard(txId);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto txIt = shard.utxos.find(txId);
+    if (txIt == shard.utxos.end()) {
+        return false;
+    }
+    auto outIt = txIt->second.find(outputIndex);
+    if (outIt == txIt->second.end()) {
+        return false;
+    }
+    utxo = outIt->second;
+    return true;
+}
+
+void UTXOPool::indexUTXO(const UTXO& utxo) {
+    if (utxo.isSpent()) {
+        return;
+    }
+    AddressShard& shard = addressShard(utxo.getOwner());
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.index[utxo.getOwner()].insert({utxo.getAmount(), utxo.getTxId(), utxo.getOutputIndex()});
+}
+
+void UTXOPool::unindexUTXO(const UTXO& utxo) {
+    AddressShard& shard = addressShard(utxo.getOwner());
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.index.find(utxo.getOwner());
+    if (it == shard.index.end()) {
+        return;
+    }
+    it->second.erase({utxo.getAmount(), utxo.getTxId(), utxo.getOutputIndex()});
+    if (it->second.empty()) {
+        shard.index.erase(it);
+    }
+}
+
+std::vector<UTXO> UTXOPool::resolve(const std::vector<CoinCandidate>& candidates) const {
     std::vector<UTXO> result;
-    for (const auto& txPair : utxos_) {
-        for (const auto& utxoPair : txPair.second) {
-            const UTXO& utxo = utxoPair.second;
-            if (utxo.getOwner() == address && !utxo.isSpent()) {
-                result.push_back(utxo);
-            }
+    result.reserve(candidates.size());
+    for (const auto& candidate : candidates) {
+        UTXO utxo;
+        // 读取索引后UTXO可能已被并发花费，这种情况直接跳过
+        if (findUTXO(candidate.txId, candidate.outputIndex, utxo)) {
+            result.push_back(utxo);
         }
     }
     return result;
 }
 
+std::vector<UTXO> UTXOPool::getUTXOsForAddress(const std::string& address) const {
+    std::vector<CoinCandidate> candidates;
+    {
+        const AddressShard& shard = addressShard(address);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(address);
+        if (it == shard.index.end()) {
+            return std::vector<UTXO>();
+        }
+        candidates.assign(it->second.begin(), it->second.end());
+    }
+    return resolve(candidates);
+}
+
 double UTXOPool::getBalance(const std::string& address) const {
     double balance = 0.0;
-    for (const auto& txPair : utxos_) {
-        for (const auto& utxoPair : txPair.second) {
-            const UTXO& utxo = utxoPair.second;
-            if (utxo.getOwner() == address && !utxo.isSpent()) {
-                balance += utxo.getAmount();
-            }
+    const AddressShard& shard = addressShard(address);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.index.find(address);
+    if (it != shard.index.end()) {
+        for (const auto& candidate : it->second) {
+            balance += candidate.amount;
         }
     }
     return balance;
@@ -73,30 +217,77 @@ bool UTXOPool::hasEnoughFunds(const std::string& address, double amount) const {
 }
 
 std::vector<UTXO> UTXOPool::selectUTXOs(const std::string& address, double amount) const {
-    std::vector<UTXO> selectedUTXOs;
-    double remainingAmount = amount;
-    
-    // 获取该地址的所有UTXO
-    auto utxos = getUTXOsForAddress(address);
-    
-    // 按金额从大到小排序
-    std::sort(utxos.begin(), utxos.end(), 
-        [](const UTXO& a, const UTXO& b) { return a.getAmount() > b.getAmount(); });
-    
-    // 贪心算法选择UTXO
-    for (const auto& utxo : utxos) {
-        if (remainingAmount <= 0) break;
-        
-        selectedUTXOs.push_back(utxo);
-        remainingAmount -= utxo.getAmount();
-    }
-    
-    // 如果没有足够的UTXO，返回空列表
-    if (remainingAmount > 0) {
+    // 在按金额排序的地址索引上选币，不再全表扫描和排序
+    CoinSelectionResult result;
+    {
+        const AddressShard& shard = addressShard(address);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(address);
+        if (it == shard.index.end()) {
+            return std::vector<UTXO>();
+        }
+        result = CoinSelector().select(it->second, amount);
+        // 需要的输入数超过默认上限时不限制输入数再选一次，保持与旧的贪心选币一样能凑够金额
+        if (!result.success) {
+            result = CoinSelector(std::numeric_limits<size_t>::max()).select(it->second, amount);
+        }
+    }
+    if (!result.success) {
+        return std::vector<UTXO>();
+    }
+    return resolve(result.selected);
+}
+
+std::vector<UTXO> UTXOPool::selectUTXOs(const std::string& address, double amount,
+                                        CoinSelectionStrategy strategy, size_t maxInputs) const {
+    CoinSelectionResult result;
+    {
+        const AddressShard& shard = addressShard(address);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(address);
+        if (it == shard.index.end()) {
+            return std::vector<UTXO>();
+        }
+        result = CoinSelector(maxInputs).select(it->second, amount, strategy);
+    }
+    if (!result.success) {
         return std::vector<UTXO>();
     }
-    
-    return selectedUTXOs;
+    return resolve(result.selected);
+}
+
+std::vector<UTXO> UTXOPool::getAllUTXOs() const {
+    std::vector<UTXO> result;
+    for (const auto& shard : outpointShards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& txPair : shard.utxos) {
+            for (const auto& utxoPair : txPair.second) {
+                result.push_back(utxoPair.second);
+            }
+        }
+    }
+    return result;
+}
+
+std::string UTXOPool::getCommitment() const {
+    std::lock_guard<std::mutex> lock(commitment_mutex_);
+    return commitment_.finalize();
+}
+
+std::string UTXOPool::computeCommitment(const std::vector<UTXO>& utxos) {
+    MuHash muhash;
+    for (const auto& utxo : utxos) {
+        muhash.insert(commitmentKey(utxo));
+    }
+    return muhash.finalize();
+}
+
+std::string UTXOPool::commitmentKey(const UTXO& utxo) {
+    // 金额使用固定精度输出，保证不同节点得到相同的字节序列
+    std::stringstream ss;
+    ss << utxo.getTxId() << ":" << utxo.getOutputIndex() << ":"
+       << std::setprecision(17) << utxo.getAmount() << ":" << utxo.getOwner();
+    return ss.str();
 }
 
 std::string UTXO::toJson() const {
@@ -1,10 +1,15 @@
 #pragma once
 
 #include "transaction.h"
+#include "muhash.h"
+#include "coinselector.h"
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <array>
+#include <mutex>
+#include <shared_mutex>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -33,17 +38,69 @@ private:
     bool spent_;
 };
 
+// UTXO集合按分片组织，每个分片有独立的读写锁：
+// 多个验证线程可以并发读取，同一时间只有一个写者在应用区块。
 class UTXOPool {
 public:
     UTXOPool();
+    UTXOPool(const UTXOPool&) = delete;
+    UTXOPool& operator=(const UTXOPool&) = delete;
     
     void addUTXO(const UTXO& utxo);
     void removeUTXO(const std::string& txId, int outputIndex);
+    // 按区块中的交易顺序花费输入、添加输出（整个区块由同一个写者完成）
+    void applyTransactions(const std::vector<Transaction>& transactions);
+    // 清空后换成给定的UTXO集合（导入已校验的快照时使用）
+    void replaceAll(const std::vector<UTXO>& utxos);
+    bool findUTXO(const std::string& txId, int outputIndex, UTXO& utxo) const;
     std::vector<UTXO> getUTXOsForAddress(const std::string& address) const;
     double getBalance(const std::string& address) const;
     bool hasEnoughFunds(const std::string& address, double amount) const;
+    // 默认策略选币；默认输入数上限内凑不够时不限制输入数
     std::vector<UTXO> selectUTXOs(const std::string& address, double amount) const;
+    // 按指定策略和输入数上限选币
+    std::vector<UTXO> selectUTXOs(const std::string& address, double amount,
+                                  CoinSelectionStrategy strategy,
+                                  size_t maxInputs = CoinSelector::DEFAULT_MAX_INPUTS) const;
+    // 获取全部UTXO（用于快照导出）
+    std::vector<UTXO> getAllUTXOs() const;
+    
+    // UTXO集合承诺（MuHash），每次增删O(1)维护
+    std::string getCommitment() const;
+    // 对任意一组UTXO计算承诺，用于校验导入的快照
+    static std::string computeCommitment(const std::vector<UTXO>& utxos);
     
 private:
-    std::map<std::string, std::map<int, UTXO>> utxos_; // txId -> (outputIndex -> UTXO)
-}; 
\ No newline at end of file
+    static const size_t SHARD_COUNT = 16;
+
+    struct OutpointShard {
+        mutable std::shared_mutex mutex;
+        std::map<std::string, std::map<int, UTXO>> utxos; // txId -> (outputIndex -> UTXO)
+    };
+    struct AddressShard {
+        mutable std::shared_mutex mutex;
+        std::map<std::string, CoinSet> index;             // owner -> 按金额排序的UTXO
+    };
+
+    std::array<OutpointShard, SHARD_COUNT> outpointShards_;
+    std::array<AddressShard, SHARD_COUNT> addressShards_;
+    std::mutex writer_mutex_;                               // 写者之间互斥
+    MuHash commitment_;
+    mutable std::mutex commitment_mutex_;
+
+    OutpointShard& outpointShard(const std::string& txId);
+    const OutpointShard& outpointShard(const std::string& txId) const;
+    AddressShard& addressShard(const std::string& owner);
+    const AddressShard& addressShard(const std::string& owner) const;
+
+    // 以下方法要求调用者已持有 writer_mutex_
+    void addUTXOLocked(const UTXO& utxo);
+    void removeUTXOLocked(const std::string& txId, int outputIndex);
+    void indexUTXO(const UTXO& utxo);
+    void unindexUTXO(const UTXO& utxo);
+
+    std::vector<UTXO> resolve(const std::vector<CoinCandidate>& candidates) const;
+
+    // 承诺中使用的UTXO序列化形式（不包含spent标记）
+    static std::string commitmentKey(const UTXO& utxo);
+};